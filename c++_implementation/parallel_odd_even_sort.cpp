@@ -1,6 +1,14 @@
 /**
  * @file parallel_odd_even_sort.cpp
- * @brief This program generates arrays with random integers, sorts them using different sorting functions, and exports the execution times to a CSV file.
+ * @brief This program generates arrays with random keys, sorts them using different sorting functions, and exports the execution times to a CSV file.
+ * Run it with --help for the command line options.
+ * Build it with -DODD_EVEN_SORT_GIT_REV="\"$(git rev-parse --short HEAD)\"" and -DODD_EVEN_SORT_BUILD_FLAGS="\"<flags>\""
+ * to record the revision and compiler flags in the JSON Lines results.
+ * Build it with -DODD_EVEN_SORT_PARALLEL_STL (and -ltbb with libstdc++) to add the std::execution::par_unseq baseline.
+ * Build it with -DODD_EVEN_SORT_INSTRUMENT to count the work of every (p,k) stage of Listings 1 to 4, see StageCounters.
+ * Link it with -pthread for the *Pool listings, which run on a persistent team of pinned threads, see ThreadPool.
+ * Build it with -DODD_EVEN_SORT_BACKEND="\"openmp\"", "\"threads\"" or "\"std\"" to choose the default backend of the
+ * parallel engines, see runTeam(); without it they run on OpenMP, or on the thread pool when built without -fopenmp.
  * @version 1.0
  * @date 14th May 2023
  * @author Shuta Gunraku
@@ -13,436 +21,5694 @@
 #include <fstream>
 #include <vector>
 #include <cmath>
+#include <functional>
+#include <type_traits>
+#include <cstdint>
+#include <array>
+#include <utility>
+#include <limits>
+#include <string>
+#include <set>
+#include <iomanip>
+#include <map>
+#include <tuple>
+#include <sstream>
+#include <cstdlib>
+#include <ctime>
+#include <cstring>
+#include <thread>
+#include <atomic>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(ODD_EVEN_SORT_PARALLEL_STL) && __has_include(<execution>)
+#include <execution>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <cerrno>
+#include <linux/futex.h>
+#include <pthread.h>
+#define ODD_EVEN_SORT_HAVE_PERF 1
+#define ODD_EVEN_SORT_HAVE_FUTEX 1
+#define ODD_EVEN_SORT_HAVE_AFFINITY 1
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define ODD_EVEN_SORT_HAVE_AVX2 1
+#endif
 
 using namespace std;
 
+/**
+ * One compare-exchange of a sorting network: after it, A[lo] is not ordered after A[hi].
+*/
+struct Comparator
+{
+    int lo;
+    int hi;
+};
+
+/**
+ * A key with its payload stored side by side (array-of-structures layout).
+ * 
+ * @tparam K the key type
+ * @tparam V the payload type, usually a row index
+*/
+template<typename K, typename V>
+struct KeyValue
+{
+    K key;
+    V value;
+};
+
+/**
+ * Orders KeyValue elements by their key only, so the listings can sort them directly.
+ * 
+ * @tparam K the key type
+ * @tparam V the payload type
+ * @tparam Compare the ordering of the keys
+*/
+template<typename K, typename V, typename Compare = std::less<K>>
+struct KeyValueOrder
+{
+    bool operator()(const KeyValue<K, V>& a, const KeyValue<K, V>& b) const
+    {
+        return Compare()(a.key, b.key);
+    }
+};
+
+/**
+ * Settings of one benchmark run, read from the command line by parseArguments().
+*/
+struct BenchmarkOptions
+{
+    std::vector<long> sizes = {10, 100, 1000};
+    std::vector<std::string> algos;     // empty runs every listing
+    std::vector<int> threads;           // empty runs at OpenMP's default thread count
+    int warmup = 1;                     // untimed runs before the timed repetitions
+    int reps = 5;                       // timed repetitions always made
+    int maxReps = 0;                    // more repetitions allowed until the CI is narrow enough; 0 means reps
+    double ciWidth = 0.05;              // target width of the 95% CI of the median, relative to the median
+    std::vector<std::string> dists = {"uniform"};   // each is run in turn, see generateKeys()
+    std::string dist = "uniform";       // the distribution of the current run
+    unsigned long seed = 0;
+    bool seeded = false;                // false draws the seed from std::random_device
+    std::string out = "output.csv";     // the listings CSV; other suites write next to it, see csvPath()
+    std::string json;                   // JSON Lines file of every result, empty for none
+    std::vector<std::string> keyTypes = {"int"};
+    std::vector<std::string> valueTypes = {"uint32_t"};
+    std::vector<int> batchLengths = {8, 16, 32, 64};
+    std::vector<std::string> suites = {"listings"};
+    bool perf = false;                  // count hardware events around every sort of the listings suite
+    std::string pin = "none";           // thread pinning policy: none, compact or scatter
+    bool traceStages = false;           // print the execution chosen for every stage of the adaptive engine
+    std::string backend;                // backend of the parallel engines, see runTeam(); empty keeps the build's default
+    double bandwidth = 0;               // peak memory bandwidth in GB/s; 0 measures it at startup
+};
+
+// Number of hardware events counted with --perf, see perfEventNames
+const int perfEventCount = 7;
+
+/**
+ * An open perf_event group counting hardware events of the calling thread.
+*/
+struct PerfCounters
+{
+    int leader = -1;                                        // -1 if the group could not be opened
+    std::array<int, perfEventCount> fds;                    // -1 for events the machine does not count
+    std::array<uint64_t, perfEventCount> ids;               // kernel ids matching the values of a group read
+};
+
+/**
+ * @brief A sense-reversing barrier for a fixed number of threads.
+ * Every thread flips its own sense on arrival; the last to arrive resets the count and publishes its sense,
+ * which releases the others. Waiting threads spin for a while and then sleep on a futex until released.
+*/
+struct SpinFutexBarrier
+{
+    int threads = 1;
+    std::atomic<int> remaining{1};      // threads still to arrive in the current episode
+    std::atomic<int> sense{0};          // sense of the last completed episode
+    std::atomic<int> sleepers{0};       // threads asleep on the futex
+};
+
+/**
+ * Barrier statistics of one pool thread, on its own cache line.
+*/
+struct alignas(64) BarrierStats
+{
+    long long barriers = 0;
+    long double waitSeconds = 0;
+};
+
+struct ThreadPool;
+
+/**
+ * One thread's view of a thread pool task: its index, the team size and the stage barrier.
+*/
+struct PoolTeam
+{
+    long threadId;
+    long threadCount;
+    ThreadPool* pool;
+    int* sense;                         // the calling thread's barrier sense
+
+    void barrier();
+
+    // Runs this thread's slice of a stage, then waits for every other slice
+    template<typename Work> void stage(Work work)
+    {
+        work(threadId, threadCount);
+        barrier();
+    }
+
+    // Runs work on thread 0 only, then waits for it
+    template<typename Work> void single(Work work)
+    {
+        if (threadId == 0) {
+            work();
+        }
+        barrier();
+    }
+};
+
+/**
+ * One thread's view of an OpenMP parallel region, so the stage loops can be shared with the thread pool.
+*/
+struct OpenMPTeam
+{
+    long threadId = 0;
+    long threadCount = 1;
+
+    void barrier()
+    {
+        #pragma omp barrier
+    }
+
+    // Runs this thread's slice of a stage, then waits for every other slice
+    template<typename Work> void stage(Work work)
+    {
+        work(threadId, threadCount);
+        barrier();
+    }
+
+    // Runs work on thread 0 only, then waits for it
+    template<typename Work> void single(Work work)
+    {
+        if (threadId == 0) {
+            work();
+        }
+        barrier();
+    }
+};
+
+/**
+ * @brief A team of the std::execution backend, seen from the one thread that walks the stages.
+ * The parallel algorithms give no guarantee that their iterations run concurrently, so a barrier inside them
+ * could deadlock; instead every stage is one std::for_each under std::execution::par over threadCount slices,
+ * and the end of the algorithm is the barrier.
+*/
+struct StdExecutionTeam
+{
+    long threadId = 0;
+    long threadCount = 1;               // the number of slices of every stage
+
+    template<typename Work> void stage(Work work)
+    {
+        std::vector<long> slices(threadCount);
+        for (long slice = 0; slice < threadCount; slice++) {
+            slices[slice] = slice;
+        }
+        long count = threadCount;
+#if defined(ODD_EVEN_SORT_PARALLEL_STL) && defined(__cpp_lib_execution)
+        std::for_each(std::execution::par, slices.begin(), slices.end(), [&](long slice) { work(slice, count); });
+#else
+        std::for_each(slices.begin(), slices.end(), [&](long slice) { work(slice, count); });
+#endif
+    }
+
+    template<typename Work> void single(Work work)
+    {
+        work();
+    }
+};
+
+/**
+ * The backend and team size the last parallel engine actually ran with, reported after every sort.
+*/
+struct BackendRun
+{
+    std::string name;                   // "openmp", "threads", "std", "simd" or "serial"; empty if no parallel engine ran
+    int threads = 0;
+};
+
+/**
+ * The place of every logical CPU in the machine, read from sysfs by readCpuTopology().
+*/
+struct CpuTopology
+{
+    std::vector<int> node;              // NUMA node of every logical CPU
+    std::vector<int> package;
+    std::vector<int> core;
+    int nodeCount = 1;
+};
+
+/**
+ * Per-machine costs of the stage execution modes, measured once at startup by calibrateStageCosts().
+*/
+struct StageCostModel
+{
+    double scalarNs = 0;                // one comparator with the scalar kernel
+    double simdNs = 0;                  // one comparator with the AVX2 kernel, in runs of at least 8
+    std::map<std::pair<std::string, int>, double> barrierNs;   // one stage barrier, by backend and thread count
+};
+
+/**
+ * How the adaptive engine runs one (p,k) stage: on one thread with the scalar kernel, on one thread with
+ * the AVX2 kernel, or split over every thread and followed by a barrier.
+*/
+enum class StageMode { Serial, Simd, Threaded };
+
+struct StageDecision
+{
+    int p;
+    int k;
+    long comparators;
+    StageMode mode;
+    double estimatedNs;
+};
+
+void stopThreadPool(ThreadPool& pool);
+
+/**
+ * @brief A persistent team of worker threads, pinned one per logical CPU, that runs one task at a time.
+ * The calling thread is thread 0 of every task; workers 1 and up sleep on the barrier between tasks.
+*/
+struct ThreadPool
+{
+    std::vector<std::thread> workers;
+    int threadCount = 0;                // including the calling thread
+    SpinFutexBarrier barrier;
+    int callerSense = 0;
+    const std::function<void(PoolTeam&)>* task = nullptr;
+    bool stopping = false;
+    std::vector<BarrierStats> stats;
+
+    ~ThreadPool()
+    {
+        stopThreadPool(*this);
+    }
+};
+
+/**
+ * Instrumentation policy of the listings that counts nothing; its hooks compile away entirely.
+*/
+struct NoInstrumentation
+{
+    static constexpr bool enabled = false;
+
+    static void stage(int, int) {}
+    static void pass() {}
+    static void test() {}
+    static void comparison() {}
+    static void swap() {}
+    static void reset() {}
+};
+
+/**
+ * @brief Instrumentation policy of the listings that counts their work per (p,k) stage.
+ * A pass is one sweep along the array, a test is one evaluation of a listing's index filter,
+ * a comparison is one call of the key ordering and a swap is one exchange of two keys.
+ * The counts are process-wide and not atomic, so only the serial listings are instrumented.
+*/
+struct StageCounters
+{
+    static constexpr bool enabled = true;
+    static constexpr int levels = 32;   // p and k are powers of two below 2^31
+
+    struct Counts
+    {
+        long long passes;
+        long long tests;
+        long long comparisons;
+        long long swaps;
+    };
+
+    // counts[log2(p)][log2(k)], and the stage the other hooks count into
+    inline static std::array<std::array<Counts, levels>, levels> counts{};
+    inline static Counts* current = &counts[0][0];
+
+    static int level(int x)
+    {
+        int l = 0;
+        while (x > 1) {
+            x /= 2;
+            l++;
+        }
+        return l;
+    }
+
+    static void stage(int p, int k) { current = &counts[level(p)][level(k)]; }
+    static void pass() { current->passes++; }
+    static void test() { current->tests++; }
+    static void comparison() { current->comparisons++; }
+    static void swap() { current->swaps++; }
+    static void reset() { counts = {}; }
+};
+
+// The listings call the hooks through ODD_EVEN_SORT_COUNT, which drops them before compilation when
+// instrumentation is off: even empty inline calls can change GCC's register allocation in the loop nests.
+#ifdef ODD_EVEN_SORT_INSTRUMENT
+using Instrumentation = StageCounters;
+#define ODD_EVEN_SORT_COUNT(hook) Instrumentation::hook
+#else
+using Instrumentation = NoInstrumentation;
+#define ODD_EVEN_SORT_COUNT(hook) ((void)0)
+#endif
+
+/**
+ * Summary of the timed repetitions of one sort, in seconds.
+*/
+struct TimingStats
+{
+    std::vector<long double> samples;
+    long double min = 0;
+    long double median = 0;
+    long double mean = 0;
+    long double stddev = 0;
+    long double p95 = 0;
+    long double ciLow = 0;              // bootstrap 95% confidence interval of the median
+    long double ciHigh = 0;
+    std::vector<std::array<long long, perfEventCount>> events;  // hardware counts of every repetition, -1 where not counted
+};
+
 // Function prototype
 void exportToCSV(const std::string& filename, const std::vector<long double>& data, const std::vector<long>& sizes);
 
-long double executeListing(int A[], int n, int* (*sortFunc)(int[], int), const std::string& sortFuncName);
+template<typename T, typename Compare = std::less<>> TimingStats executeListing(T A[], int n, T* (*sortFunc)(T[], int), const std::string& sortFuncName, const BenchmarkOptions& options);
+template<typename T, typename Compare = std::less<>> void verifySorted(const T A[], const T sorted[], int n, const std::string& sortFuncName);
+template<typename T> const T& sortKey(const T& element);
+template<typename K, typename V> const K& sortKey(const KeyValue<K, V>& element);
+TimingStats measureRuns(const std::function<void()>& restore, const std::function<void()>& run, const BenchmarkOptions& options, bool countEvents = false);
+TimingStats summariseTimes(const std::vector<long double>& samples);
+long double quantile(const std::vector<long double>& sorted, double q);
+void printTimingStats(const std::string& name, const TimingStats& stats);
+void writeTimingStats(std::fstream& outputFile, const TimingStats& stats);
+const std::array<std::string, perfEventCount>& perfEventNames();
+bool openPerfCounters(PerfCounters& counters);
+void startPerfCounters(const PerfCounters& counters);
+std::array<long long, perfEventCount> stopPerfCounters(const PerfCounters& counters);
+void closePerfCounters(PerfCounters& counters);
+long double medianEvent(const TimingStats& stats, int event);
+void printEventStats(const TimingStats& stats, int n);
+void writeEventStats(std::fstream& outputFile, const TimingStats& stats, int n);
+std::string csvHeader(const std::string& suite);
+std::string csvPath(const std::string& out, const std::string& suite);
+bool openCsv(const std::string& path, const std::string& header, std::fstream& file);
+std::string describeRun(const BenchmarkOptions& options, int argc, char* argv[]);
+void writeJsonRecord(const std::string& suite, const std::string& fields, const TimingStats& stats);
+std::string jsonString(const std::string& text);
+std::string jsonNumber(long double value);
+int currentThreadCount();
+void printStageCounts();
+void writeStageCounts(const std::string& keyType, const std::string& dist, int n, const std::string& algo);
+template<typename T, typename Compare = std::less<T>> std::vector<std::pair<T* (*)(T*, int), std::string>> listingFunctions();
+template<typename T, typename Compare = std::less<T>> void benchmarkKeyType(const std::string& keyType, const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile);
+template<typename T, typename Compare = std::less<T>> void benchmarkScaling(const std::string& keyType, const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile);
+template<typename Visitor> void visitKeyType(const std::string& keyType, Visitor&& visit);
+std::vector<int> scalingThreadCounts(const BenchmarkOptions& options);
+std::string serialListingName(const std::string& name);
+int logicalCpuCount();
+int physicalCoreCount();
+template<typename K, typename V> TimingStats executeKeyValueListing(K keys[], V values[], int n, K* (*sortFunc)(K[], V[], int), const std::string& sortFuncName, const BenchmarkOptions& options);
+template<typename K, typename V> void verifyKeyValue(const K keys[], const K sortedKeys[], const V sortedValues[], int n, const std::string& sortFuncName);
+template<typename K, typename V> void benchmarkKeyValue(const std::string& valueType, const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile);
+void benchmarkBatch(const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile);
+void benchmarkFixed(const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile);
+template<int N> void benchmarkFixedLength(const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile);
+template<typename T> void generateKeys(T A[], long n, const std::string& dist, uint64_t seed);
+template<typename T, typename KeyAt> void fillKeys(T A[], long n, const KeyAt& keyAt);
+template<typename T, typename W> T fullRangeKey(uint64_t bits);
+uint64_t splitMix64(uint64_t x);
+uint64_t counterRandom(uint64_t stream, uint64_t counter);
+double unitInterval(uint64_t bits);
+template<typename T> T clampKey(long double value);
+bool parseDistribution(const std::string& text, std::string& name, double& parameter);
+
+bool parseArguments(int argc, char* argv[], BenchmarkOptions& options);
+bool parseSizes(const std::string& text, std::vector<long>& sizes);
+long parseSize(const std::string& text);
+std::vector<std::string> splitList(const std::string& text);
+void printUsage(const char* program);
+void setThreadCount(int threads);
+
+template<typename T, typename Compare = std::less<T>> T* sortListing1(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing1Parallel(T A[], int n);
+
+template<typename T, typename Compare = std::less<T>> T* sortListing2(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing2Parallel(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing2ParallelAlt(T A[], int n);
+
+template<typename T, typename Compare = std::less<T>> T* sortListing3(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing3Parallel(T A[], int n);
 
-int* sortListing1(int A[], int n);
-int* sortListing1Parallel(int A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4Parallel(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4AVX2(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4Network16(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4Blocked(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4Hybrid(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4ParallelTasks(T A[], int n);
+template<typename T, typename Compare> void oddEvenMergeSortTask(T A[], int n, long lo, long size, Compare comp, bool useAVX2, int cutoff);
+template<typename T, typename Compare> void oddEvenMergeTask(T A[], int m, int p, Compare comp, bool useAVX2, int cutoff);
+template<typename T, typename Compare, typename Team> void listing4TiledStages(T A[], int n, int tile, Compare comp, bool useAVX2, Team& team);
+template<typename T, typename Compare = std::less<T>> T* sortListing4ParallelAdaptive(T A[], int n);
+template<typename T, typename Compare, typename Team> void listing4AdaptiveStages(T A[], int n, Compare comp, bool useAVX2, const std::vector<StageDecision>& plan, Team& team);
+std::vector<StageDecision> planStages(int n, int threads, bool simd);
+const char* stageModeName(StageMode mode);
+long stageComparators(int n, int p, int k);
+void calibrateStageCosts(const std::vector<int>& threadCounts);
+double stageBarrierNs(int threads);
+double measureStageBarrierNs(int threads);
+void printStagePlan(bool everyStage);
 
-int* sortListing2(int A[], int n);
-int* sortListing2Parallel(int A[], int n);
-int* sortListing2ParallelAlt(int A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing2ParallelAltPool(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4ParallelPool(T A[], int n);
+template<typename T, typename Compare = std::less<T>> T* sortListing4HybridPool(T A[], int n);
+template<typename T, typename Compare, typename Team> void listing2AltStages(T A[], int n, Compare comp, bool useAVX2, Team& team);
+template<typename T, typename Compare, typename Team> void listing4Stages(T A[], int n, Compare comp, bool useAVX2, Team& team);
+template<typename T, typename Compare, typename Team> void listing4HybridStages(T A[], int n, Compare comp, bool useAVX2, Team& team);
+OpenMPTeam openMPTeam();
+template<typename Task> void runTeam(Task task);
+std::string defaultBackend();
+bool backendAvailable(const std::string& backend);
+int backendThreadCount();
+void noteOpenMPBackend();
+void printBackend(const BackendRun& run);
 
-int* sortListing3(int A[], int n);
-int* sortListing3Parallel(int A[], int n);
+void barrierWait(SpinFutexBarrier& barrier, int& localSense);
+void resetBarrier(SpinFutexBarrier& barrier, int threads);
+ThreadPool& sharedThreadPool();
+void startThreadPool(ThreadPool& pool, int threads);
+void threadPoolWorker(ThreadPool* pool, int threadId);
+void runOnThreadPool(const std::function<void(PoolTeam&)>& task);
+bool pinThread(std::thread& thread, int cpu);
+bool pinCurrentThread(int cpu);
+void pinOpenMPThreads();
+std::vector<int> parseCpuList(const std::string& text);
+CpuTopology readCpuTopology();
+std::vector<int> pinningOrder(const CpuTopology& topology, const std::string& policy);
+template<typename T> T* firstTouchArray(long n);
+void printPagePlacement(const void* data, size_t bytes);
+long streamArrayLength();
+long double triadBandwidth(const std::vector<int>& computeCpus, const std::vector<int>& memoryCpus);
+void printNodeBandwidth(const CpuTopology& topology);
+void resetBarrierStats();
+void printBarrierStats();
 
-int* sortListing4(int A[], int n);
-int* sortListing4Parallel(int A[], int n);
+template<typename T> T* sortStd(T A[], int n);
+template<typename T> T* sortStdStable(T A[], int n);
+template<typename T> T* sortStdParUnseq(T A[], int n);
+template<typename T> T* sortRadixLSD(T A[], int n);
+template<typename T> T* sortRadixLSDParallel(T A[], int n);
+template<typename T> typename std::conditional<sizeof(T) == 8, uint64_t, uint32_t>::type radixKey(T key);
+bool isBaseline(const std::string& name);
+long double measureBandwidth();
+long double peakBandwidth(const BenchmarkOptions& options);
+long minimumPasses(const std::string& name, int n, size_t keySize, int threads);
+
+template<typename T, typename Compare = std::less<T>> T* sortBatchTransposed(T data[], int length, long batches);
+template<typename T> void interleaveArrays(const T arrays[], T data[], int length, long arrayCount);
+template<typename T> void deinterleaveArrays(const T data[], T arrays[], int length, long arrayCount);
+std::vector<std::pair<int, int>> comparatorSchedule(int n);
+void sortBatchTransposedAVX2(int data[], int length, long batches, const std::vector<std::pair<int, int>>& schedule);
+
+template<int N> constexpr int comparatorCount();
+template<int N> constexpr std::array<Comparator, comparatorCount<N>()> comparatorNetwork();
+template<int N, typename T, typename Compare = std::less<T>> T* sortFixed(T A[]);
+
+template<typename K, typename V, typename Compare = std::less<K>> K* sortListing3KeyValue(K keys[], V values[], int n);
+template<typename K, typename V, typename Compare = std::less<K>> K* sortListing4KeyValue(K keys[], V values[], int n);
+
+bool cpuHasAVX2();
+template<typename T, typename Compare> void compareExchangeRun(T lo[], T hi[], long len, Compare comp);
+template<typename T, typename Compare> void compareExchangeRunVector(T lo[], T hi[], long len, Compare comp, bool useAVX2);
+void compareExchangeRunAVX2(int lo[], int hi[], int len);
+void sortBlocks16AVX2(int A[], int n, bool descending);
+template<typename T, typename Compare> void applyFusedLevels(T A[], int n, int p, int kTop, Compare comp, bool useAVX2);
+template<typename T, typename Compare> void applyLevel(T A[], int n, int p, int k, Compare comp, bool useAVX2);
+template<typename T, typename Compare> void applyLevelSlice(T A[], int n, int p, int k, Compare comp, bool useAVX2, long threadId, long threadCount);
+int cacheTileSize(size_t elementSize);
+template<typename K, typename V, typename Compare> void compareExchangeRunKeyValue(K lo[], K hi[], V loValues[], V hiValues[], long len, Compare comp);
+template<typename K, typename V, typename Compare> void compareExchangeRunKeyValueVector(K lo[], K hi[], V loValues[], V hiValues[], long len, Compare comp, bool useAVX2);
+void compareExchangeRunKeyValueAVX2(int lo[], int hi[], uint32_t loValues[], uint32_t hiValues[], int len);
+void compareExchangeRunKeyValueAVX2(int lo[], int hi[], uint64_t loValues[], uint64_t hiValues[], int len);
+
+// Number of sweeps over the whole array made by the last sort, for the engines that count them
+long passCount = 0;
+
+// Number of arrays sorted side by side by the batched sort, one per 32-bit AVX2 lane
+const int batchLanes = 8;
+
+// Largest array size accepted by --sizes; the listings index with int and form 2*p, p+k and j+k,
+// which stay below 2^31 only while n is at most 2^30
+const long maxArraySize = 1L << 30;
+
+// Threads requested with --threads, for the engines that do not take their count from OpenMP; 0 means one per logical CPU
+int requestedThreads = 0;
+
+// Iterations a thread spins on a barrier before it sleeps on the futex
+const int barrierSpinLimit = 4096;
+
+// Whether the pool threads time their barrier waits, set by --trace-stages or an instrumented build
+bool timeBarriers = Instrumentation::enabled;
+
+// Backend the parallel engines run on, see runTeam()
+std::string parallelBackend = defaultBackend();
+
+// Backend of the last sort, set by the parallel engines
+BackendRun backendUsed;
+
+// Costs the adaptive engine plans its stages with
+StageCostModel stageCosts;
+
+// The stage plan of the last adaptive sort, kept for the trace
+std::vector<StageDecision> stagePlan;
+
+// The persistent thread pool, started by the first task that runs on it
+ThreadPool threadPool;
+
+// The NUMA nodes, packages and cores of the logical CPUs
+CpuTopology cpuTopology;
+
+// Logical CPU of every thread index, set by --pin; empty leaves OpenMP threads where the OS puts them
+std::vector<int> pinnedCpus;
+
+// Hardware event group opened by main() when --perf is given
+PerfCounters perfCounters;
+
+// JSON Lines file opened by main() when --json is given, and the run metadata repeated in every record
+std::fstream jsonOutput;
+std::string runMetadata;
+
+// Per-stage work counts of instrumented builds, opened by main() next to the listings CSV
+std::fstream stageOutput;
+
+// Sustainable memory bandwidth in bytes per second of every team size measured so far, see peakBandwidth()
+std::map<int, long double> peakBandwidths;
 
 /**
  * Main function of the program
+ * @param argc the number of command line arguments
+ * @param argv the command line arguments, see printUsage()
  * @return 0 if the program is successful
 */
-int main() 
+int main(int argc, char* argv[]) 
 {
+    BenchmarkOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        return 1;
+    }
+
     // Generate random numbers
-    std::random_device rd;
-    std::mt19937 generator(rd());
-    std::uniform_int_distribution<int> distribution(1, 100); // Configure the range of the random numbers
+    if (!options.seeded) {
+        std::random_device rd;
+        options.seed = rd();
+    }
+    std::mt19937 generator(static_cast<std::mt19937::result_type>(options.seed));
+    cout << "Seed: " << options.seed << endl;
 
-    // Configure the size of arrays to be sorted
-    std::vector<long> sizes;
-    sizes.push_back(1);
-    sizes.push_back(2);
-    sizes.push_back(3);
+    timeBarriers = timeBarriers || options.traceStages;
 
-    std::vector<long double> executionTimes;
+    // Choose the backend and say what will really run in parallel
+    if (!options.backend.empty()) {
+        parallelBackend = options.backend;
+    }
+    if (!backendAvailable(parallelBackend)) {
+        cout << "Backend " << parallelBackend << " is not available in this build" << endl;
+        return 1;
+    }
+    int backendThreads = backendThreadCount();
+    cout << "Parallel backend: " << parallelBackend << ", " << backendThreads << (backendThreads == 1 ? " thread" : " threads") << endl;
+#ifndef _OPENMP
+    cout << "Built without OpenMP: Listing1Parallel, Listing2Parallel, Listing3Parallel and RadixLSDParallel run serially, "
+         << "Listing4ParallelTasks runs stage by stage on the " << parallelBackend << " backend" << endl;
+#endif
 
-    // Function pointers
-    auto sortFunc1 = sortListing1;
-    auto sortFunc1Parallel = sortListing1Parallel;
-    auto sortFunc2 = sortListing2;
-    auto sortFunc2Parallel = sortListing2Parallel;
-    auto sortFunc2ParallelAlt = sortListing2ParallelAlt;
-    auto sortFunc3 = sortListing3; 
-    auto sortFunc3Parallel = sortListing3Parallel;
-    auto sortFunc4 = sortListing4;
-    auto sortFunc4Parallel = sortListing4Parallel;
+    // Pin the threads before any array is first touched, so that its pages land next to the threads that sort them
+    cpuTopology = readCpuTopology();
+    pinnedCpus = pinningOrder(cpuTopology, options.pin);
+    if (!pinnedCpus.empty()) {
+        pinOpenMPThreads();
+        cout << "Pinning threads " << options.pin << " over " << cpuTopology.nodeCount << " NUMA node(s), thread t on CPU";
+        for (size_t t = 0; t < pinnedCpus.size() && t < 16; t++) {
+            cout << (t > 0 ? "," : " ") << pinnedCpus[t];
+        }
+        cout << (pinnedCpus.size() > 16 ? ",..." : "") << endl;
+        printNodeBandwidth(cpuTopology);
+    }
 
-    // Function list
-    typedef int* (*SortFunction)(int*, int);
-    std::vector<std::pair<SortFunction, std::string>> funcList = {
-        {sortFunc1, "Listing1"},
-        {sortFunc1Parallel, "Listing1Parallel"},
-        {sortFunc2, "Listing2"},
-        {sortFunc2Parallel, "Listing2Parallel"},
-        {sortFunc2ParallelAlt, "Listing2ParallelAlt"},
-        {sortFunc3, "Listing3"},
-        {sortFunc3Parallel, "Listing3Parallel"},
-        {sortFunc4, "Listing4"},
-        {sortFunc4Parallel, "Listing4Parallel"}
-    };
+    // Open one output file per suite, each with a single header row
+    std::map<std::string, std::fstream> outputFiles;
+    for (const std::string& suite : options.suites) {
+        if (!openCsv(csvPath(options.out, suite), csvHeader(suite), outputFiles[suite])) {
+            return 1;
+        }
+    }
+
+    if (options.bandwidth > 0 && std::find(options.suites.begin(), options.suites.end(), "listings") != options.suites.end()) {
+        cout << "Peak memory bandwidth: " << options.bandwidth << " GB/s" << endl;
+    }
+
+    // Calibrate the adaptive engine's cost model for every thread count it may run with
+    bool listingSuites = false;
+    for (const std::string& suite : options.suites) {
+        listingSuites = listingSuites || suite == "listings" || suite == "scaling";
+    }
+    if (listingSuites && (options.algos.empty() || std::find(options.algos.begin(), options.algos.end(), "Listing4ParallelAdaptive") != options.algos.end())) {
+        std::vector<int> threadCounts = options.threads;
+        threadCounts.push_back(backendThreadCount());
+        for (int threads : scalingThreadCounts(options)) {
+            threadCounts.push_back(threads);
+        }
+        calibrateStageCosts(threadCounts);
+    }
 
-    // Open the output file
-    std::fstream outputFile("output.csv", std::ios::out | std::ios::app);
-    if (!outputFile.is_open()) {
-        std::cout << "Error opening file: " << "output.csv" << std::endl;
+    if (Instrumentation::enabled && !openCsv(csvPath(options.out, "stages"), csvHeader("stages"), stageOutput)) {
         return 1;
     }
 
-    // Write column headers
-    outputFile << "n";
-    for (const auto& func : funcList) {
-        outputFile << "," << func.second;
+    if (!options.json.empty()) {
+        jsonOutput.open(options.json, std::ios::out | std::ios::app);
+        if (!jsonOutput.is_open()) {
+            std::cout << "Error opening file: " << options.json << std::endl;
+            return 1;
+        }
+        runMetadata = describeRun(options, argc, argv);
     }
-    outputFile << std::endl;
-    
-    // Generate arrays of random numbers and sort them
-    for (int zeroCount: sizes) {
-         
-            int n = pow(10, zeroCount);
-            int* A = new int[n];
-            for (int i = 0; i < n; i++) {
-                A[i] = distribution(generator);
+
+    // Without access to the counters the benchmarks still run, and the counter columns stay empty
+    if (options.perf && !openPerfCounters(perfCounters)) {
+        cout << "Hardware counters unavailable: running without them" << endl;
+    }
+
+    for (const std::string& dist : options.dists) {
+        options.dist = dist;
+        cout << "Input distribution: " << dist << endl;
+        for (const std::string& suite : options.suites) {
+            std::fstream& outputFile = outputFiles[suite];
+            if (suite == "listings") {
+                for (const std::string& keyType : options.keyTypes) {
+                    visitKeyType(keyType, [&](auto key, auto order) {
+                        benchmarkKeyType<decltype(key), decltype(order)>(keyType, options, generator, outputFile);
+                    });
+                }
+            } else if (suite == "scaling") {
+                for (const std::string& keyType : options.keyTypes) {
+                    visitKeyType(keyType, [&](auto key, auto order) {
+                        benchmarkScaling<decltype(key), decltype(order)>(keyType, options, generator, outputFile);
+                    });
+                }
+            } else if (suite == "keyvalue") {
+                for (const std::string& valueType : options.valueTypes) {
+                    if (valueType == "uint32_t") {
+                        benchmarkKeyValue<int, uint32_t>(valueType, options, generator, outputFile);
+                    } else if (valueType == "uint64_t") {
+                        benchmarkKeyValue<int, uint64_t>(valueType, options, generator, outputFile);
+                    }
+                }
+            } else if (suite == "batch") {
+                benchmarkBatch(options, generator, outputFile);
+            } else if (suite == "fixed") {
+                benchmarkFixed(options, generator, outputFile);
             }
+        }
+    }
+
+    // Close the output files
+    for (auto& outputFile : outputFiles) {
+        outputFile.second.close();
+    }
+    jsonOutput.close();
+    stageOutput.close();
+    closePerfCounters(perfCounters);
+
+    return 0;
+}
+
+
+/**
+ * Prints the command line options of the program.
+ * 
+ * @param program the name the program was started with
+*/
+void printUsage(const char* program)
+{
+    cout << "Usage: " << program << " [options]" << endl
+         << "  --sizes LIST          array sizes, e.g. 1000,4096,1e6,10^9,2^20, or a range" << endl
+         << "                        START:END[:FACTOR] such as 1e3:1e9:10 or 2^10:2^30:2 (default 10,100,1000), at most 2^30" << endl
+         << "  --algos LIST          listings to run, e.g. Listing4,Listing4Parallel (default all), and the baselines" << endl
+         << "                        StdSort,StdStableSort,RadixLSD,RadixLSDParallel[,StdSortParUnseq]" << endl
+         << "  --threads LIST        thread counts to run every listing with, under OpenMP and on the pinned thread" << endl
+         << "                        pool of the *Pool listings (default OpenMP's choice, one pool thread per CPU)" << endl
+         << "  --warmup N            untimed runs before the timed repetitions (default 1)" << endl
+         << "  --reps N              timed repetitions of every listing, each on a fresh copy (default 5)" << endl
+         << "  --max-reps N          keep repeating up to N times until the 95% CI of the median" << endl
+         << "                        is narrower than --ci-width (default: no extra repetitions)" << endl
+         << "  --ci-width X          target CI width relative to the median (default 0.05)" << endl
+         << "  --dist LIST           input distributions, each run in turn (default uniform):" << endl
+         << "                        uniform      keys 1..100" << endl
+         << "                        uniform32    keys over the whole 32-bit range, clipped to the key type" << endl
+         << "                        uniform64    keys over the whole 64-bit range, clipped to the key type" << endl
+         << "                        sorted       0, 1, ..., n-1" << endl
+         << "                        reverse      n, n-1, ..., 1" << endl
+         << "                        nearly:X     sorted, then X% of n random pairs swapped (default 1)" << endl
+         << "                        organpipe    ascending to n/2, then descending" << endl
+         << "                        sawtooth:R   R ascending runs (default 16)" << endl
+         << "                        fewunique:K  K distinct keys 1..K (default 16)" << endl
+         << "                        zipf:S       Zipfian ranks 1..min(n,2^20) with exponent S (default 1)" << endl
+         << "                        gaussian:SD  normal keys with standard deviation SD (default 1e6), mean 0," << endl
+         << "                                     or 8*SD for unsigned keys, rounded and clamped to the key type" << endl
+         << "  --seed N              random seed, printed on every run (default random)" << endl
+         << "  --keys LIST           key types: int,uint32_t,int64_t,uint64_t,float,double (default int), and int_desc," << endl
+         << "                        int keys sorted in descending order by the listings only" << endl
+         << "  --values LIST         payload types of the keyvalue suite: uint32_t,uint64_t (default uint32_t)" << endl
+         << "  --batch-lengths LIST  array lengths of the batch suite (default 8,16,32,64)" << endl
+         << "  --suites LIST         benchmarks to run: listings,scaling,keyvalue,batch,fixed (default listings)" << endl
+         << "                        scaling runs the parallel listings at 1, 2, 4, ... threads up to the core count" << endl
+         << "                        and at the SMT count (or at --threads), against their serial listing" << endl
+         << "                        the batch and fixed suites take --sizes as the number of arrays" << endl
+         << "  --out FILE            CSV file the listings results are appended to (default output.csv);" << endl
+         << "                        the other suites append to FILE_<suite>.csv, e.g. output_scaling.csv" << endl
+         << "  --json FILE           also append every result with the run metadata to FILE as JSON Lines" << endl
+         << "  --bandwidth GBPS      peak memory bandwidth the listings are compared with (default: measured" << endl
+         << "                        with STREAM copy and triad kernels on the backend, once per thread count)" << endl
+         << "  --perf                count cycles, instructions, L1D, LLC, branch, dTLB and NUMA node misses of" << endl
+         << "                        every listing with perf_event_open (Linux; needs perf_event_paranoid <= 2)" << endl
+         << "  --backend NAME        where the parallel engines run their team of threads (default: " << defaultBackend() << ")" << endl
+         << "                        openmp    one OpenMP parallel region (needs -fopenmp)" << endl
+         << "                        threads   the persistent pinned thread pool" << endl
+         << "                        std       one std::execution::par algorithm per stage (needs -DODD_EVEN_SORT_PARALLEL_STL)" << endl
+         << "  --pin POLICY          pin thread t of OpenMP and of the thread pool to one logical CPU (Linux):" << endl
+         << "                        none      leave placement to the OS (default)" << endl
+         << "                        compact   fill the SMT threads of a core, then the cores of a node, node by node" << endl
+         << "                        scatter   one thread per core, round robin over the nodes, then the SMT threads" << endl
+         << "                        and report the triad bandwidth between every pair of NUMA nodes" << endl
+         << "  --trace-stages        print the execution Listing4ParallelAdaptive chose for every (p,k) stage:" << endl
+         << "                        serial, simd or threaded, with its comparators and estimated time," << endl
+         << "                        and time the barrier waits of the thread pool" << endl
+         << "  --help                print this message" << endl;
+}
+
+
+/**
+ * Splits a comma separated list, dropping empty items.
+ * 
+ * @param text the list
+ * @return the items
+*/
+std::vector<std::string> splitList(const std::string& text)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos) {
+            comma = text.size();
+        }
+        if (comma > start) {
+            items.push_back(text.substr(start, comma - start));
+        }
+        start = comma + 1;
+    }
+    return items;
+}
 
-            cout << "Sorting an array of length n = pow(10," << zeroCount << ")" << endl;
 
-            for (const auto& func : funcList) {
-                executionTimes.push_back(executeListing(A, n, func.first, func.second));
+/**
+ * Parses one array size written as an integer (4096), in scientific notation (1e6) or as a power (10^9, 2^20).
+ * 
+ * @param text the size
+ * @return the size, or -1 if it is not a whole number between 1 and the largest int
+*/
+long parseSize(const std::string& text)
+{
+    long double value;
+    try {
+        size_t used = 0;
+        size_t caret = text.find('^');
+        if (caret != std::string::npos) {
+            long double base = std::stold(text.substr(0, caret), &used);
+            if (used != caret) {
+                return -1;
+            }
+            std::string exponentText = text.substr(caret + 1);
+            long double exponent = std::stold(exponentText, &used);
+            if (used != exponentText.size()) {
+                return -1;
             }
+            value = std::pow(base, exponent);
+        } else {
+            value = std::stold(text, &used);
+            if (used != text.size()) {
+                return -1;
+            }
+        }
+    } catch (const std::exception&) {
+        return -1;
+    }
+
+    if (value < 1 || value > std::numeric_limits<int>::max() || value != std::floor(value)) {
+        return -1;
+    }
+    return static_cast<long>(value);
+}
 
-            // Write the execution times to the output file
-            outputFile << n << ",";
-            for(long double time : executionTimes) {
-                outputFile << time << ",";
+
+/**
+ * Parses a list of array sizes; each item is a size or a geometric range START:END[:FACTOR].
+ * 
+ * @param text the list
+ * @param sizes receives the sizes in the order given
+ * @return true if every item is valid and no size exceeds maxArraySize
+*/
+bool parseSizes(const std::string& text, std::vector<long>& sizes)
+{
+    sizes.clear();
+    auto fits = [](long n) {
+        if (n > maxArraySize) {
+            std::cout << "Array size " << n << " exceeds the largest supported size 2^30 = " << maxArraySize << std::endl;
+            return false;
+        }
+        return true;
+    };
+    for (const std::string& item : splitList(text)) {
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) {
+            long n = parseSize(item);
+            if (n < 0 || !fits(n)) {
+                return false;
             }
+            sizes.push_back(n);
+            continue;
+        }
+
+        size_t second = item.find(':', colon + 1);
+        long first = parseSize(item.substr(0, colon));
+        long last = parseSize(item.substr(colon + 1, second == std::string::npos ? std::string::npos : second - colon - 1));
+        long factor = second == std::string::npos ? 10 : parseSize(item.substr(second + 1));
+        if (first < 0 || last < first || factor < 2 || !fits(last)) {
+            return false;
+        }
+        for (long n = first; n <= last; n *= factor) {
+            sizes.push_back(n);
+        }
+    }
+    return !sizes.empty();
+}
 
-            outputFile << std::endl;
 
-            // Deallocate the dynamic array
-            delete[] A;
+/**
+ * @brief Reads the command line into the benchmark options.
+ * Options are given as "--name value" or "--name=value". Unknown options and invalid values
+ * print an error and the usage.
+ * 
+ * @param argc the number of command line arguments
+ * @param argv the command line arguments
+ * @param options receives the settings; options not given keep their defaults
+ * @return true if the program should run
+*/
+bool parseArguments(int argc, char* argv[], BenchmarkOptions& options)
+{
+    std::vector<std::string> listingNames;
+    for (const auto& func : listingFunctions<int>()) {
+        listingNames.push_back(func.second);
+    }
+    auto contains = [](const std::vector<std::string>& list, const std::string& item) {
+        return std::find(list.begin(), list.end(), item) != list.end();
+    };
+    auto allIn = [&](const std::vector<std::string>& items, const std::vector<std::string>& allowed) {
+        if (items.empty()) {
+            return false;
+        }
+        for (const std::string& item : items) {
+            if (!contains(allowed, item)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto parseCounts = [](const std::string& text, std::vector<int>& counts) {
+        counts.clear();
+        for (const std::string& item : splitList(text)) {
+            long count = parseSize(item);
+            if (count < 0) {
+                return false;
+            }
+            counts.push_back(count);
+        }
+        return !counts.empty();
+    };
+
+    for (int a = 1; a < argc; a++) {
+        std::string name = argv[a];
+        std::string value;
+        size_t equals = name.find('=');
+        if (equals != std::string::npos) {
+            value = name.substr(equals + 1);
+            name = name.substr(0, equals);
+        } else if (name != "--help" && name != "--perf" && name != "--trace-stages" && a + 1 < argc) {
+            value = argv[++a];
+        }
 
-            // Clear the vector
-            executionTimes.clear();
+        bool valid = true;
+        if (name == "--help") {
+            printUsage(argv[0]);
+            return false;
+        } else if (name == "--perf") {
+            options.perf = true;
+            valid = value.empty();
+        } else if (name == "--trace-stages") {
+            options.traceStages = true;
+            valid = value.empty();
+        } else if (name == "--backend") {
+            options.backend = value;
+            valid = backendAvailable(value);
+            if (!valid && (value == "openmp" || value == "std")) {
+                cout << "Backend " << value << " is not available in this build: "
+                     << (value == "openmp" ? "compile with -fopenmp" : "compile with -DODD_EVEN_SORT_PARALLEL_STL and link -ltbb") << endl;
+            }
+        } else if (name == "--pin") {
+            options.pin = value;
+            valid = value == "none" || value == "compact" || value == "scatter";
+        } else if (name == "--bandwidth") {
+            try {
+                size_t used = 0;
+                options.bandwidth = std::stod(value, &used);
+                valid = used == value.size() && options.bandwidth > 0;
+            } catch (const std::exception&) {
+                valid = false;
+            }
+        } else if (name == "--sizes") {
+            valid = parseSizes(value, options.sizes);
+        } else if (name == "--algos") {
+            options.algos = splitList(value);
+            valid = allIn(options.algos, listingNames);
+        } else if (name == "--threads") {
+            valid = parseCounts(value, options.threads);
+        } else if (name == "--warmup") {
+            options.warmup = value == "0" ? 0 : parseSize(value);
+            valid = options.warmup >= 0;
+        } else if (name == "--reps") {
+            options.reps = parseSize(value);
+            valid = options.reps > 0;
+        } else if (name == "--max-reps") {
+            options.maxReps = parseSize(value);
+            valid = options.maxReps > 0;
+        } else if (name == "--ci-width") {
+            try {
+                size_t used = 0;
+                options.ciWidth = std::stod(value, &used);
+                valid = used == value.size() && options.ciWidth > 0;
+            } catch (const std::exception&) {
+                valid = false;
+            }
+        } else if (name == "--dist") {
+            options.dists = splitList(value);
+            valid = !options.dists.empty();
+            for (const std::string& dist : options.dists) {
+                std::string distName;
+                double parameter;
+                valid = valid && parseDistribution(dist, distName, parameter);
+            }
+        } else if (name == "--seed") {
+            try {
+                size_t used = 0;
+                options.seed = std::stoul(value, &used);
+                valid = used == value.size();
+            } catch (const std::exception&) {
+                valid = false;
+            }
+            options.seeded = true;
+        } else if (name == "--keys") {
+            options.keyTypes = splitList(value);
+            valid = allIn(options.keyTypes, {"int", "uint32_t", "int64_t", "uint64_t", "float", "double", "int_desc"});
+        } else if (name == "--values") {
+            options.valueTypes = splitList(value);
+            valid = allIn(options.valueTypes, {"uint32_t", "uint64_t"});
+        } else if (name == "--batch-lengths") {
+            valid = parseCounts(value, options.batchLengths);
+        } else if (name == "--suites") {
+            options.suites = splitList(value);
+            valid = allIn(options.suites, {"listings", "scaling", "keyvalue", "batch", "fixed"});
+        } else if (name == "--out") {
+            options.out = value;
+            valid = !value.empty();
+        } else if (name == "--json") {
+            options.json = value;
+            valid = !value.empty();
+        } else {
+            cout << "Unknown option: " << name << endl;
+            printUsage(argv[0]);
+            return false;
+        }
+
+        if (!valid) {
+            cout << "Invalid value for " << name << ": " << value << endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Sets the number of threads the parallel listings run with, both under OpenMP and on the thread pool.
+ * 
+ * @param threads the thread count, or 0 for OpenMP's default
+*/
+void setThreadCount(int threads)
+{
+    if (threads <= 0) {
+        return;
+    }
+    requestedThreads = threads;
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+    pinOpenMPThreads();
+#else
+    cout << "Built without OpenMP: the OpenMP-only listings ignore " << threads << " threads" << endl;
+#endif
+}
+
+
+/**
+ * Splits an input distribution written as NAME or NAME:PARAMETER, and fills in the default parameter.
+ * 
+ * @param text the distribution, see printUsage()
+ * @param name set to the name of the distribution
+ * @param parameter set to the parameter of the distribution
+ * @return true if the distribution is known and its parameter is valid
+*/
+bool parseDistribution(const std::string& text, std::string& name, double& parameter)
+{
+    size_t colon = text.find(':');
+    name = text.substr(0, colon);
+
+    if (name == "nearly") {
+        parameter = 1;
+    } else if (name == "sawtooth" || name == "fewunique") {
+        parameter = 16;
+    } else if (name == "zipf") {
+        parameter = 1;
+    } else if (name == "gaussian") {
+        parameter = 1e6;
+    } else {
+        // The remaining distributions take no parameter
+        return colon == std::string::npos &&
+               (name == "uniform" || name == "uniform32" || name == "uniform64" ||
+                name == "sorted" || name == "reverse" || name == "organpipe");
+    }
+
+    if (colon != std::string::npos) {
+        try {
+            std::string parameterText = text.substr(colon + 1);
+            size_t used = 0;
+            parameter = std::stod(parameterText, &used);
+            if (used != parameterText.size()) {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    if (name == "nearly") {
+        return parameter >= 0 && parameter <= 100;
+    }
+    if (name == "sawtooth" || name == "fewunique") {
+        return parameter >= 1 && parameter == std::floor(parameter);
+    }
+    return parameter > 0;
+}
+
+
+/**
+ * Fills an array with random keys drawn from the named input distribution.
+ * Every key is computed from the seed and its own position with a counter-based generator, so the array is filled
+ * in parallel and is the same for a given seed at every thread count.
+ * Position-based distributions (sorted, reverse, organpipe, sawtooth) store the position as the key, so keys
+ * wrap around for n beyond the range of small key types, as any cast would.
+ * 
+ * @tparam T the key type
+ * @param A the array to fill
+ * @param n the size of the array
+ * @param dist the distribution, see printUsage()
+ * @param seed the seed of the counter-based generator
+*/
+template<typename T>
+void generateKeys(T A[], long n, const std::string& dist, uint64_t seed)
+{
+    std::string name;
+    double parameter = 0;
+    parseDistribution(dist, name, parameter);
+    uint64_t stream = splitMix64(seed);
+
+    if (name == "uniform") {
+        // Configure the range of the random numbers
+        fillKeys(A, n, [stream](long i) {
+            uint64_t bits = counterRandom(stream, i);
+            return std::is_integral<T>::value ? static_cast<T>(1 + bits % 100) : static_cast<T>(1 + 99 * unitInterval(bits));
+        });
+    } else if (name == "uniform32") {
+        fillKeys(A, n, [stream](long i) { return fullRangeKey<T, int32_t>(counterRandom(stream, i)); });
+    } else if (name == "uniform64") {
+        fillKeys(A, n, [stream](long i) { return fullRangeKey<T, int64_t>(counterRandom(stream, i)); });
+    } else if (name == "sorted" || name == "nearly") {
+        fillKeys(A, n, [](long i) { return static_cast<T>(i); });
+        if (name == "nearly" && n > 1) {
+            // The swaps may touch the same positions, so they are made one after another in a fixed order
+            long swaps = static_cast<long>(n * parameter / 100);
+            uint64_t swapStream = splitMix64(stream);
+            for (long s = 0; s < swaps; s++) {
+                std::swap(A[counterRandom(swapStream, 2 * s) % n], A[counterRandom(swapStream, 2 * s + 1) % n]);
+            }
+        }
+    } else if (name == "reverse") {
+        fillKeys(A, n, [n](long i) { return static_cast<T>(n - i); });
+    } else if (name == "organpipe") {
+        fillKeys(A, n, [n](long i) { return static_cast<T>(std::min(i, n - 1 - i)); });
+    } else if (name == "sawtooth") {
+        long period = std::max(1L, (n + static_cast<long>(parameter) - 1) / static_cast<long>(parameter));
+        fillKeys(A, n, [period](long i) { return static_cast<T>(i % period); });
+    } else if (name == "fewunique") {
+        uint64_t distinct = static_cast<uint64_t>(parameter);
+        fillKeys(A, n, [stream, distinct](long i) { return static_cast<T>(1 + counterRandom(stream, i) % distinct); });
+    } else if (name == "zipf") {
+        // Inverse transform sampling over the cumulative weights of the ranks
+        long ranks = std::max(1L, std::min(n, 1L << 20));
+        std::vector<double> cumulative(ranks);
+        double total = 0;
+        for (long r = 0; r < ranks; r++) {
+            total += 1 / std::pow(r + 1.0, parameter);
+            cumulative[r] = total;
+        }
+        const double* weights = cumulative.data();
+        fillKeys(A, n, [stream, weights, ranks, total](long i) {
+            long rank = std::lower_bound(weights, weights + ranks, total * unitInterval(counterRandom(stream, i))) - weights;
+            return static_cast<T>(std::min(rank, ranks - 1) + 1);
+        });
+    } else if (name == "gaussian") {
+        // Box-Muller transform of two uniform numbers per key
+        double mean = std::is_unsigned<T>::value ? 8 * parameter : 0;
+        double deviation = parameter;
+        const double pi = 3.14159265358979323846;
+        fillKeys(A, n, [stream, mean, deviation, pi](long i) {
+            double u1 = 1 - unitInterval(counterRandom(stream, 2 * i));
+            double u2 = unitInterval(counterRandom(stream, 2 * i + 1));
+            long double value = mean + deviation * std::sqrt(-2 * std::log(u1)) * std::cos(2 * pi * u2);
+            return clampKey<T>(std::is_integral<T>::value ? std::round(value) : value);
+        });
+    }
+}
+
+
+/**
+ * Sets A[i] = keyAt(i) for every position, splitting the positions evenly among the threads of the selected
+ * backend, see runTeam(), so that the keys are generated in parallel on OpenMP, the thread pool or std::execution.
+ * 
+ * @tparam T the key type
+ * @tparam KeyAt a function from a position to its key
+ * @param A the array to fill
+ * @param n the size of the array
+ * @param keyAt the key of each position
+*/
+template<typename T, typename KeyAt>
+void fillKeys(T A[], long n, const KeyAt& keyAt)
+{
+    runTeam([&](auto& team) {
+        team.stage([&](long threadId, long threadCount) {
+            for (long i = n * threadId / threadCount; i < n * (threadId + 1) / threadCount; i++) {
+                A[i] = keyAt(i);
+            }
+        });
+    });
+}
+
+
+/**
+ * @brief The SplitMix64 finaliser: a bijective mix of 64 bits.
+ * @see https://prng.di.unimi.it/splitmix64.c
+ * 
+ * @param x the bits to mix
+ * @return the mixed bits
+*/
+uint64_t splitMix64(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+
+/**
+ * Returns the counter-th output of the SplitMix64 stream started at stream, without computing the ones before it.
+ * 
+ * @param stream the start of the stream
+ * @param counter the position in the stream
+ * @return 64 random bits
+*/
+uint64_t counterRandom(uint64_t stream, uint64_t counter)
+{
+    return splitMix64(stream + (counter + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+
+/**
+ * Maps 64 random bits to a double in [0, 1).
+ * 
+ * @param bits the random bits
+ * @return the number, a multiple of 2^-53
+*/
+double unitInterval(uint64_t bits)
+{
+    return (bits >> 11) * 0x1.0p-53;
+}
+
+
+/**
+ * Maps 64 random bits to a key spread evenly over the whole range of a W-bit integer, or of the key type if that is narrower.
+ * Unsigned key types take the range of the unsigned W; floating-point keys take the integer values of W.
+ * 
+ * @tparam T the key type
+ * @tparam W the signed integer type whose range is drawn from
+ * @param bits the random bits
+ * @return the key
+*/
+template<typename T, typename W>
+T fullRangeKey(uint64_t bits)
+{
+    using Wide = typename std::conditional<std::is_unsigned<T>::value, typename std::make_unsigned<W>::type, W>::type;
+    using Drawn = typename std::conditional<std::is_integral<T>::value && sizeof(T) < sizeof(W), T, Wide>::type;
+
+    return static_cast<T>(static_cast<Drawn>(static_cast<typename std::make_unsigned<Drawn>::type>(bits)));
+}
+
+
+/**
+ * Converts a value to the key type, saturating at the ends of its range.
+ * 
+ * @tparam T the key type
+ * @param value the value
+ * @return the nearest key
+*/
+template<typename T>
+T clampKey(long double value)
+{
+    if (value <= static_cast<long double>(std::numeric_limits<T>::lowest())) {
+        return std::numeric_limits<T>::lowest();
+    }
+    if (value >= static_cast<long double>(std::numeric_limits<T>::max())) {
+        return std::numeric_limits<T>::max();
+    }
+    return static_cast<T>(value);
+}
+
+
+/**
+ * Returns every sorting function instantiated for one key type and ordering: the listings, then the baselines.
+ * The baselines only sort in ascending order, so they are left out for any other ordering.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @return the sorting functions and their names
+*/
+template<typename T, typename Compare>
+std::vector<std::pair<T* (*)(T*, int), std::string>> listingFunctions()
+{
+    // Function pointers
+    auto sortFunc1 = sortListing1<T, Compare>;
+    auto sortFunc1Parallel = sortListing1Parallel<T, Compare>;
+    auto sortFunc2 = sortListing2<T, Compare>;
+    auto sortFunc2Parallel = sortListing2Parallel<T, Compare>;
+    auto sortFunc2ParallelAlt = sortListing2ParallelAlt<T, Compare>;
+    auto sortFunc3 = sortListing3<T, Compare>; 
+    auto sortFunc3Parallel = sortListing3Parallel<T, Compare>;
+    auto sortFunc4 = sortListing4<T, Compare>;
+    auto sortFunc4Parallel = sortListing4Parallel<T, Compare>;
+    auto sortFunc4AVX2 = sortListing4AVX2<T, Compare>;
+    auto sortFunc4Network16 = sortListing4Network16<T, Compare>;
+    auto sortFunc4Blocked = sortListing4Blocked<T, Compare>;
+    auto sortFunc4Hybrid = sortListing4Hybrid<T, Compare>;
+    auto sortFunc4ParallelTasks = sortListing4ParallelTasks<T, Compare>;
+    auto sortFunc4ParallelAdaptive = sortListing4ParallelAdaptive<T, Compare>;
+    auto sortFunc2ParallelAltPool = sortListing2ParallelAltPool<T, Compare>;
+    auto sortFunc4ParallelPool = sortListing4ParallelPool<T, Compare>;
+    auto sortFunc4HybridPool = sortListing4HybridPool<T, Compare>;
+
+    // Function list
+    std::vector<std::pair<T* (*)(T*, int), std::string>> funcList = {
+        {sortFunc1, "Listing1"},
+        {sortFunc1Parallel, "Listing1Parallel"},
+        {sortFunc2, "Listing2"},
+        {sortFunc2Parallel, "Listing2Parallel"},
+        {sortFunc2ParallelAlt, "Listing2ParallelAlt"},
+        {sortFunc3, "Listing3"},
+        {sortFunc3Parallel, "Listing3Parallel"},
+        {sortFunc4, "Listing4"},
+        {sortFunc4Parallel, "Listing4Parallel"},
+        {sortFunc4AVX2, "Listing4AVX2"},
+        {sortFunc4Network16, "Listing4Network16"},
+        {sortFunc4Blocked, "Listing4Blocked"},
+        {sortFunc4Hybrid, "Listing4Hybrid"},
+        {sortFunc4ParallelTasks, "Listing4ParallelTasks"},
+        {sortFunc4ParallelAdaptive, "Listing4ParallelAdaptive"},
+        {sortFunc2ParallelAltPool, "Listing2ParallelAltPool"},
+        {sortFunc4ParallelPool, "Listing4ParallelPool"},
+        {sortFunc4HybridPool, "Listing4HybridPool"}
+    };
+    if constexpr (std::is_same<Compare, std::less<T>>::value) {
+        funcList.push_back({sortStd<T>, "StdSort"});
+        funcList.push_back({sortStdStable<T>, "StdStableSort"});
+        funcList.push_back({sortRadixLSD<T>, "RadixLSD"});
+        funcList.push_back({sortRadixLSDParallel<T>, "RadixLSDParallel"});
+#if defined(ODD_EVEN_SORT_PARALLEL_STL) && defined(__cpp_lib_execution)
+        funcList.push_back({sortStdParUnseq<T>, "StdSortParUnseq"});
+#endif
+    }
+    return funcList;
+}
+
+
+/**
+ * Generates arrays of random keys of one type, sorts them with the selected listings and writes the timing statistics.
+ * Every size is run at every thread count; each (listing, size, threads) cell is one row.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param keyType the name of the key type written to the output file
+ * @param options the sizes, listings, thread counts, repetitions and input distribution
+ * @param generator the random number generator
+ * @param outputFile the CSV file the timing statistics are appended to
+*/
+template<typename T, typename Compare>
+void benchmarkKeyType(const std::string& keyType, const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile)
+{
+    std::vector<std::pair<T* (*)(T*, int), std::string>> funcList;
+    for (const auto& func : listingFunctions<T, Compare>()) {
+        if (options.algos.empty() || std::find(options.algos.begin(), options.algos.end(), func.second) != options.algos.end()) {
+            funcList.push_back(func);
+        }
+    }
+
+    std::vector<int> threadCounts = options.threads;
+    if (threadCounts.empty()) {
+        threadCounts.push_back(0);
+    }
+
+    // Generate arrays of random numbers and sort them
+    for (long size : options.sizes) {
+
+            int n = size;
+            T* A = firstTouchArray<T>(n);
+            auto start = std::chrono::steady_clock::now();
+            generateKeys(A, n, options.dist, generator());
+            auto end = std::chrono::steady_clock::now();
+            cout << "Generated " << n << " " << options.dist << " keys in "
+                 << std::chrono::duration<long double>(end - start).count() << " seconds" << endl;
+            printPagePlacement(A, n * sizeof(T));
+
+            for (int threads : threadCounts) {
+                setThreadCount(threads);
+
+                cout << "Sorting an array of " << keyType << " of length n = " << n;
+                if (threads > 0) {
+                    cout << " with " << threads << " threads";
+                }
+                cout << endl;
+
+                long double peak = peakBandwidth(options);
+                std::vector<TimingStats> results;
+                std::vector<long double> minimumBytes;
+                std::vector<BackendRun> backends;
+                for (const auto& func : funcList) {
+                    results.push_back(executeListing<T, Compare>(A, n, func.first, func.second, options));
+                    backends.push_back(backendUsed.name.empty() ? BackendRun{"serial", 1} : backendUsed);
+                    writeStageCounts(keyType, options.dist, n, func.second);
+
+                    // Each pass reads and writes the whole array, counted like the STREAM copy kernel
+                    long passes = minimumPasses(func.second, n, sizeof(T), backends.back().threads);
+                    minimumBytes.push_back(2.0L * passes * n * sizeof(T));
+                    if (passes > 0 && peak > 0) {
+                        long double achieved = minimumBytes.back() / results.back().median;
+                        cout << "Bandwidth: " << achieved / 1e9L << " GB/s over " << passes << " passes, "
+                             << 100 * achieved / peak << "% of peak" << endl;
+                    }
+                }
+
+                // Every sort is reported as a multiple of the fastest baseline that ran
+                long double bestBaseline = 0;
+                std::string bestBaselineName;
+                for (size_t f = 0; f < funcList.size(); f++) {
+                    if (isBaseline(funcList[f].second) && (bestBaselineName.empty() || results[f].median < bestBaseline)) {
+                        bestBaseline = results[f].median;
+                        bestBaselineName = funcList[f].second;
+                    }
+                }
+                if (!bestBaselineName.empty()) {
+                    cout << "Relative to the best baseline, " << bestBaselineName << ":" << endl;
+                    for (size_t f = 0; f < funcList.size(); f++) {
+                        cout << "  " << funcList[f].second << ": " << results[f].median / bestBaseline << "x" << endl;
+                    }
+                }
+
+                for (size_t f = 0; f < funcList.size(); f++) {
+                    const TimingStats& stats = results[f];
+                    std::string relative = bestBaselineName.empty() ? "" : std::to_string((double)(stats.median / bestBaseline));
+                    std::string achieved;
+                    std::string fraction;
+                    if (minimumBytes[f] > 0 && stats.median > 0) {
+                        achieved = std::to_string((double)(minimumBytes[f] / stats.median / 1e9L));
+                        if (peak > 0) {
+                            fraction = std::to_string((double)(minimumBytes[f] / stats.median / peak));
+                        }
+                    }
+
+                    // Write the timing statistics to the output file
+                    outputFile << keyType << "," << options.dist << "," << n << "," << backendThreadCount() << "," << funcList[f].second << ",";
+                    writeTimingStats(outputFile, stats);
+                    outputFile << "," << relative << "," << bestBaselineName << "," << (long long)minimumBytes[f] << "," << achieved << "," << fraction;
+                    writeEventStats(outputFile, stats, n);
+                    outputFile << "," << backends[f].name << "," << backends[f].threads;
+                    outputFile << std::endl;
+
+                    writeJsonRecord("listings", "\"key\":" + jsonString(keyType) + ",\"dist\":" + jsonString(options.dist) +
+                                    ",\"n\":" + std::to_string(n) + ",\"threads\":" + std::to_string(backendThreadCount()) +
+                                    ",\"algo\":" + jsonString(funcList[f].second) +
+                                    ",\"backend\":" + jsonString(backends[f].name) +
+                                    ",\"backend_threads\":" + std::to_string(backends[f].threads) +
+                                    ",\"best_baseline\":" + (bestBaselineName.empty() ? "null" : jsonString(bestBaselineName)) +
+                                    ",\"vs_best_baseline\":" + (relative.empty() ? "null" : relative) +
+                                    ",\"min_bytes\":" + std::to_string((long long)minimumBytes[f]) +
+                                    ",\"bandwidth_gbps\":" + (achieved.empty() ? "null" : achieved) +
+                                    ",\"peak_bandwidth_gbps\":" + std::to_string((double)(peak / 1e9L)) +
+                                    ",\"fraction_of_peak\":" + (fraction.empty() ? "null" : fraction), stats);
+                }
+            }
+
+            // Deallocate the dynamic array
+            delete[] A;
+        }
+}
+
+
+/**
+ * @brief Runs every parallel listing of one key type over a range of thread counts, against its serial listing.
+ * The serial listing is timed once per size; speedup is its median time over the parallel median, and
+ * efficiency is the speedup per thread. A table is printed per listing and every row is written to the CSV.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param keyType the name of the key type written to the output file
+ * @param options the sizes, listings, thread counts, repetitions and input distribution
+ * @param generator the random number generator
+ * @param outputFile the CSV file the results are appended to
+*/
+template<typename T, typename Compare>
+void benchmarkScaling(const std::string& keyType, const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile)
+{
+    std::vector<std::pair<T* (*)(T*, int), std::string>> parallelList;
+    std::vector<std::pair<T* (*)(T*, int), std::string>> serialList;
+    for (const auto& func : listingFunctions<T, Compare>()) {
+        bool selected = options.algos.empty() || std::find(options.algos.begin(), options.algos.end(), func.second) != options.algos.end();
+        if (selected && serialListingName(func.second) != func.second) {
+            parallelList.push_back(func);
+        }
+    }
+    for (const auto& func : listingFunctions<T, Compare>()) {
+        for (const auto& parallel : parallelList) {
+            if (serialListingName(parallel.second) == func.second) {
+                serialList.push_back(func);
+                break;
+            }
+        }
+    }
+
+    // The sweep changes the thread count of every backend; both are put back afterwards for the suites that follow
+    std::vector<int> threadCounts = scalingThreadCounts(options);
+    int savedRequested = requestedThreads;
+#ifdef _OPENMP
+    int defaultThreads = omp_get_max_threads();
+#endif
+
+    for (long size : options.sizes) {
+
+            int n = size;
+            T* A = firstTouchArray<T>(n);
+            generateKeys(A, n, options.dist, generator());
+
+            cout << "Thread scaling on an array of " << keyType << " of length n = " << n << endl;
+
+            std::vector<std::pair<std::string, TimingStats>> baselines;
+            setThreadCount(1);
+            for (const auto& func : serialList) {
+                baselines.push_back({func.second, executeListing<T, Compare>(A, n, func.first, func.second, options)});
+            }
+
+            for (const auto& func : parallelList) {
+                std::string serialName = serialListingName(func.second);
+                long double baseline = 0;
+                for (const auto& result : baselines) {
+                    if (result.first == serialName) {
+                        baseline = result.second.median;
+                    }
+                }
+
+                std::vector<std::pair<int, TimingStats>> results;
+                for (int threads : threadCounts) {
+                    setThreadCount(threads);
+                    results.push_back({threads, executeListing<T, Compare>(A, n, func.first, func.second + " (" + std::to_string(threads) + " threads)", options)});
+                }
+
+                cout << endl << func.second << " against " << serialName << " (" << baseline << " seconds):" << endl;
+                cout << std::setw(8) << "threads" << std::setw(14) << "median (s)" << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << endl;
+                for (const auto& result : results) {
+                    long double speedup = baseline / result.second.median;
+                    long double efficiency = speedup / result.first;
+                    cout << std::setw(8) << result.first << std::setw(14) << result.second.median
+                         << std::setw(10) << std::setprecision(3) << speedup
+                         << std::setw(12) << efficiency << std::setprecision(6) << endl;
+
+                    outputFile << keyType << "," << options.dist << "," << n << "," << func.second << "," << serialName << ","
+                               << result.first << "," << result.second.samples.size() << "," << result.second.median << ","
+                               << result.second.ciLow << "," << result.second.ciHigh << "," << baseline << ","
+                               << speedup << "," << efficiency << std::endl;
+
+                    std::ostringstream fields;
+                    fields << "\"key\":" << jsonString(keyType) << ",\"dist\":" << jsonString(options.dist) << ",\"n\":" << n
+                           << ",\"threads\":" << result.first << ",\"algo\":" << jsonString(func.second)
+                           << ",\"baseline\":" << jsonString(serialName) << ",\"baseline_median\":" << jsonNumber(baseline)
+                           << ",\"speedup\":" << jsonNumber(speedup) << ",\"efficiency\":" << jsonNumber(efficiency);
+                    writeJsonRecord("scaling", fields.str(), result.second);
+                }
+                cout << endl;
+            }
+
+            // Deallocate the dynamic array
+            delete[] A;
+        }
+
+    requestedThreads = savedRequested;
+#ifdef _OPENMP
+    omp_set_num_threads(defaultThreads);
+    pinOpenMPThreads();
+#endif
+}
+
+
+/**
+ * Calls visit with a value of the key type named keyType and the ordering its keys are sorted in.
+ * 
+ * @tparam Visitor a generic callable taking the key type and the comparator by value
+ * @param keyType the name of the key type: int, uint32_t, int64_t, uint64_t, float or double in ascending order,
+ *                or int_desc for int in descending order
+ * @param visit the callable
+*/
+template<typename Visitor>
+void visitKeyType(const std::string& keyType, Visitor&& visit)
+{
+    if (keyType == "int") {
+        visit(int(), std::less<int>());
+    } else if (keyType == "uint32_t") {
+        visit(uint32_t(), std::less<uint32_t>());
+    } else if (keyType == "int64_t") {
+        visit(int64_t(), std::less<int64_t>());
+    } else if (keyType == "uint64_t") {
+        visit(uint64_t(), std::less<uint64_t>());
+    } else if (keyType == "float") {
+        visit(float(), std::less<float>());
+    } else if (keyType == "double") {
+        visit(double(), std::less<double>());
+    } else if (keyType == "int_desc") {
+        visit(int(), std::greater<int>());
+    }
+}
+
+
+/**
+ * @brief Returns the thread counts of the scaling suite.
+ * These are --threads if given, otherwise 1, 2, 4, ... up to the number of physical cores, the core count
+ * itself, and the number of logical CPUs if SMT gives more.
+ * 
+ * @param options the thread counts given on the command line
+ * @return the thread counts, ascending
+*/
+std::vector<int> scalingThreadCounts(const BenchmarkOptions& options)
+{
+    std::set<int> counts(options.threads.begin(), options.threads.end());
+    counts.erase(0);
+    if (counts.empty()) {
+        int cores = physicalCoreCount();
+        for (int threads = 1; threads < cores; threads *= 2) {
+            counts.insert(threads);
+        }
+        counts.insert(cores);
+        counts.insert(logicalCpuCount());
+    }
+    return std::vector<int>(counts.begin(), counts.end());
+}
+
+
+/**
+ * Returns the serial listing a listing is measured against: ListingN for ListingNParallel, ListingNParallelAlt,
+ * ListingNParallelTasks, ListingNHybrid and their thread pool variants, and the name itself for every serial listing.
+ * 
+ * @param name the name of the listing
+ * @return the name of the serial listing
+*/
+std::string serialListingName(const std::string& name)
+{
+    for (const char* suffix : {"Parallel", "Hybrid"}) {
+        size_t found = name.find(suffix);
+        if (found != std::string::npos) {
+            return name.substr(0, found);
+        }
+    }
+    return name;
+}
+
+
+/**
+ * Returns the number of logical CPUs online, counting every SMT thread.
+ * 
+ * @return the number of logical CPUs, at least 1
+*/
+int logicalCpuCount()
+{
+    long cpus = 0;
+#ifdef _OPENMP
+    cpus = omp_get_num_procs();
+#elif defined(_SC_NPROCESSORS_ONLN)
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return cpus > 0 ? cpus : 1;
+}
+
+
+/**
+ * Returns the number of physical cores, counting the distinct (package, core) pairs of the logical CPUs in sysfs.
+ * 
+ * @return the number of physical cores, or the number of logical CPUs if the topology cannot be read
+*/
+int physicalCoreCount()
+{
+    int cpus = logicalCpuCount();
+    std::set<std::pair<int, int>> cores;
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        int package = -1;
+        int core = -1;
+        std::ifstream(topology + "physical_package_id") >> package;
+        std::ifstream(topology + "core_id") >> core;
+        if (package < 0 || core < 0) {
+            return cpus;
+        }
+        cores.insert({package, core});
+    }
+    return cores.empty() ? cpus : cores.size();
+}
+
+
+/**
+ * Executes a sorting function repeatedly and measures the execution times.
+ * Every run, warmup or timed, sorts a fresh copy of A. With --perf, the hardware events of the timed runs are counted too.
+ * The output of the last run is checked against std::sort, and the program stops if it is wrong.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys the output is checked against
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @param sortFunc the sorting function
+ * @param sortFuncName the name of the sorting function
+ * @param options the warmup and repetition settings
+ * @return the timing statistics
+ * @see https://stackoverflow.com/questions/22387586/measuring-execution-time-of-a-function-in-c
+*/
+template<typename T, typename Compare>
+TimingStats executeListing(T A[], int n, T* (*sortFunc)(T[], int), const std::string& sortFuncName, const BenchmarkOptions& options)
+{
+    // Copy the array, into pages placed next to the threads that sort them
+    T* ACopied = firstTouchArray<T>(n);
+
+    TimingStats stats = measureRuns([&] { std::copy(A, A + n, ACopied); passCount = 0; Instrumentation::reset(); resetBarrierStats(); stagePlan.clear(); backendUsed = BackendRun(); },
+                                    [&] { sortFunc(ACopied, n); },
+                                    options, options.perf);
+    verifySorted<T, Compare>(A, ACopied, n, sortFuncName);
+
+    // Print the execution time
+    printTimingStats(sortFuncName, stats);
+    if (passCount > 0) {
+        cout << "Passes: " << passCount << endl;
+    }
+    printBackend(backendUsed);
+    printEventStats(stats, n);
+    printStageCounts();
+    printBarrierStats();
+    printStagePlan(options.traceStages);
+
+    // Deallocate dynamic arrays
+    delete[] ACopied;
+
+    return stats;
+}
+
+
+/**
+ * @brief Checks a listing's output against std::sort of its input and stops the program if they differ.
+ * Elements with equal keys may come out in any order, so only the keys are compared, see sortKey().
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<> for ascending
+ * @param A the unsorted input
+ * @param sorted the listing's output
+ * @param n the size of the arrays
+ * @param sortFuncName the name of the sorting function, printed on a mismatch
+*/
+template<typename T, typename Compare>
+void verifySorted(const T A[], const T sorted[], int n, const std::string& sortFuncName)
+{
+    Compare comp{};
+    std::vector<T> expected(A, A + n);
+    std::sort(expected.begin(), expected.end(), [&](const T& a, const T& b) { return comp(sortKey(a), sortKey(b)); });
+    for (int i = 0; i < n; i++) {
+        if (comp(sortKey(sorted[i]), sortKey(expected[i])) || comp(sortKey(expected[i]), sortKey(sorted[i]))) {
+            cout << "Error: " << sortFuncName << " sorted " << n << " keys incorrectly, position " << i
+                 << " holds " << sortKey(sorted[i]) << " instead of " << sortKey(expected[i]) << endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+/**
+ * Returns the key a listing orders an element by: the element itself.
+ * 
+ * @param element a key
+ * @return the key
+*/
+template<typename T>
+const T& sortKey(const T& element)
+{
+    return element;
+}
+
+
+/**
+ * Returns the key a listing orders an element by: the key of a key-payload pair, see KeyValueOrder.
+ * 
+ * @param element a key with its payload
+ * @return the key
+*/
+template<typename K, typename V>
+const K& sortKey(const KeyValue<K, V>& element)
+{
+    return element.key;
+}
+
+
+/**
+ * @brief Times repeated runs of a piece of work and summarises them.
+ * Makes options.warmup untimed runs, then options.reps timed runs. If options.maxReps allows more,
+ * it keeps adding runs until the bootstrap 95% CI of the median is narrower than options.ciWidth
+ * times the median. restore() is called before every run and is not timed.
+ * With countEvents, the hardware event group is enabled just outside the timed region of every repetition.
+ * 
+ * @param restore puts the input back into its unsorted state
+ * @param run the work to time
+ * @param options the warmup and repetition settings
+ * @param countEvents whether to count hardware events with perfCounters
+ * @return the timing statistics
+*/
+TimingStats measureRuns(const std::function<void()>& restore, const std::function<void()>& run, const BenchmarkOptions& options, bool countEvents)
+{
+    for (int w = 0; w < options.warmup; w++) {
+        restore();
+        run();
+    }
+
+    std::vector<long double> samples;
+    std::vector<std::array<long long, perfEventCount>> events;
+    countEvents = countEvents && perfCounters.leader >= 0;
+    int maxReps = std::max(options.reps, options.maxReps);
+    TimingStats stats;
+    while ((int)samples.size() < maxReps) {
+        restore();
+        if (countEvents) {
+            startPerfCounters(perfCounters);
+        }
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        if (countEvents) {
+            events.push_back(stopPerfCounters(perfCounters));
+        }
+        samples.push_back(std::chrono::duration<long double>(end - start).count());
+
+        if ((int)samples.size() >= options.reps) {
+            stats = summariseTimes(samples);
+            if (stats.ciHigh - stats.ciLow <= options.ciWidth * stats.median) {
+                break;
+            }
+        }
+    }
+
+    stats.events = events;
+    return stats;
+}
+
+
+/**
+ * Returns the q-quantile of sorted samples, interpolating linearly between neighbours.
+ * 
+ * @param sorted the samples in ascending order, not empty
+ * @param q the quantile, between 0 and 1
+ * @return the quantile
+*/
+long double quantile(const std::vector<long double>& sorted, double q)
+{
+    long double position = q * (sorted.size() - 1);
+    size_t below = static_cast<size_t>(position);
+    if (below + 1 >= sorted.size()) {
+        return sorted.back();
+    }
+    return sorted[below] + (position - below) * (sorted[below + 1] - sorted[below]);
+}
+
+
+/**
+ * @brief Computes the summary statistics of timed repetitions.
+ * The confidence interval of the median comes from 1000 bootstrap resamples drawn with a fixed seed,
+ * so the same samples always give the same interval.
+ * 
+ * @param samples the execution times in seconds, not empty
+ * @return the statistics
+*/
+TimingStats summariseTimes(const std::vector<long double>& samples)
+{
+    TimingStats stats;
+    stats.samples = samples;
+
+    std::vector<long double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    stats.min = sorted.front();
+    stats.median = quantile(sorted, 0.5);
+    stats.p95 = quantile(sorted, 0.95);
+
+    long double sum = 0;
+    for (long double sample : samples) {
+        sum += sample;
+    }
+    stats.mean = sum / samples.size();
+
+    long double squares = 0;
+    for (long double sample : samples) {
+        squares += (sample - stats.mean) * (sample - stats.mean);
+    }
+    stats.stddev = samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1)) : 0;
+
+    const int resamples = 1000;
+    std::mt19937 bootstrapGenerator(12345);
+    std::uniform_int_distribution<size_t> pick(0, samples.size() - 1);
+    std::vector<long double> medians(resamples);
+    std::vector<long double> resample(samples.size());
+    for (int r = 0; r < resamples; r++) {
+        for (long double& value : resample) {
+            value = samples[pick(bootstrapGenerator)];
+        }
+        std::sort(resample.begin(), resample.end());
+        medians[r] = quantile(resample, 0.5);
+    }
+    std::sort(medians.begin(), medians.end());
+    stats.ciLow = quantile(medians, 0.025);
+    stats.ciHigh = quantile(medians, 0.975);
+
+    return stats;
+}
+
+
+/**
+ * Prints the timing statistics of one sort.
+ * 
+ * @param name the name of the sort
+ * @param stats the statistics
+*/
+void printTimingStats(const std::string& name, const TimingStats& stats)
+{
+    cout << name << ": " << endl;
+    cout << "Duration: " << stats.median << " seconds (median of " << stats.samples.size()
+         << ", min " << stats.min << ", mean " << stats.mean << " +/- " << stats.stddev
+         << ", p95 " << stats.p95 << ", 95% CI [" << stats.ciLow << ", " << stats.ciHigh << "])" << endl;
+}
+
+
+/**
+ * Writes the columns reps,min,median,mean,stddev,p95,ci_low,ci_high of one sort, without a line break.
+ * 
+ * @param outputFile the CSV file
+ * @param stats the statistics
+*/
+void writeTimingStats(std::fstream& outputFile, const TimingStats& stats)
+{
+    outputFile << stats.samples.size() << "," << stats.min << "," << stats.median << "," << stats.mean << ","
+               << stats.stddev << "," << stats.p95 << "," << stats.ciLow << "," << stats.ciHigh;
+}
+
+
+/**
+ * Returns the CSV names of the hardware events counted with --perf.
+ * The first two are cycles and instructions; the others are misses, also reported per element.
+ * Node misses are reads served from the memory of another NUMA node.
+ * 
+ * @return the names, in the order of PerfCounters
+*/
+const std::array<std::string, perfEventCount>& perfEventNames()
+{
+    static const std::array<std::string, perfEventCount> names = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses", "node_misses"
+    };
+    return names;
+}
+
+
+/**
+ * @brief Opens one perf_event group for the hardware events of perfEventNames().
+ * The events count the calling thread in user space only, which is all that perf_event_paranoid = 2 allows.
+ * Threads of the parallel listings are not included, so their counts are those of the master thread.
+ * Events the machine does not support are left out of the group.
+ * @see https://man7.org/linux/man-pages/man2/perf_event_open.2.html
+ * 
+ * @param counters set to the open group
+ * @return true if at least the cycle counter could be opened
+*/
+bool openPerfCounters(PerfCounters& counters)
+{
+    counters.leader = -1;
+    counters.fds.fill(-1);
+#ifdef ODD_EVEN_SORT_HAVE_PERF
+    auto cacheMiss = [](uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    };
+    const std::array<std::pair<uint32_t, uint64_t>, perfEventCount> events = {{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB)},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_NODE)}
+    }};
+
+    for (int e = 0; e < perfEventCount; e++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[e].first;
+        attr.config = events[e].second;
+        attr.disabled = counters.leader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, counters.leader, 0);
+        if (fd < 0) {
+            if (e == 0) {
+                int paranoid = -1;
+                std::ifstream("/proc/sys/kernel/perf_event_paranoid") >> paranoid;
+                cout << "perf_event_open: " << std::strerror(errno) << " (perf_event_paranoid is " << paranoid << ")" << endl;
+                return false;
+            }
+            cout << "perf_event_open: " << perfEventNames()[e] << " not counted: " << std::strerror(errno) << endl;
+            continue;
+        }
+        counters.fds[e] = fd;
+        ioctl(fd, PERF_EVENT_IOC_ID, &counters.ids[e]);
+        if (e == 0) {
+            counters.leader = fd;
+        }
+    }
+    return true;
+#else
+    cout << "Hardware counters need Linux perf_event_open" << endl;
+    return false;
+#endif
+}
+
+
+/**
+ * Resets and starts every event of the group.
+ * 
+ * @param counters the open group
+*/
+void startPerfCounters(const PerfCounters& counters)
+{
+#ifdef ODD_EVEN_SORT_HAVE_PERF
+    ioctl(counters.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)counters;
+#endif
+}
+
+
+/**
+ * @brief Stops the group and reads its counts.
+ * If the kernel multiplexed the group with other events, the counts are scaled up to the whole enabled time.
+ * 
+ * @param counters the open group
+ * @return the count of every event, or -1 for events that were not counted
+*/
+std::array<long long, perfEventCount> stopPerfCounters(const PerfCounters& counters)
+{
+    std::array<long long, perfEventCount> counts;
+    counts.fill(-1);
+#ifdef ODD_EVEN_SORT_HAVE_PERF
+    ioctl(counters.leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // Layout of a group read: nr, time_enabled, time_running, then a value and an id per event
+    uint64_t buffer[3 + 2 * perfEventCount];
+    if (read(counters.leader, buffer, sizeof(buffer)) < 24 || buffer[2] == 0) {
+        return counts;
+    }
+    long double scale = (long double)buffer[1] / buffer[2];
+    for (uint64_t v = 0; v < buffer[0] && v < perfEventCount; v++) {
+        for (int e = 0; e < perfEventCount; e++) {
+            if (counters.fds[e] >= 0 && counters.ids[e] == buffer[4 + 2 * v]) {
+                counts[e] = std::llround(buffer[3 + 2 * v] * scale);
+            }
+        }
+    }
+#else
+    (void)counters;
+#endif
+    return counts;
+}
+
+
+/**
+ * Closes every event of the group.
+ * 
+ * @param counters the group, left closed
+*/
+void closePerfCounters(PerfCounters& counters)
+{
+#ifdef ODD_EVEN_SORT_HAVE_PERF
+    for (int& fd : counters.fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        fd = -1;
+    }
+#endif
+    counters.leader = -1;
+}
+
+
+/**
+ * Returns the median count of one hardware event over the repetitions that counted it.
+ * 
+ * @param stats the statistics of a sort
+ * @param event the index of the event in perfEventNames()
+ * @return the median count, or -1 if no repetition counted the event
+*/
+long double medianEvent(const TimingStats& stats, int event)
+{
+    std::vector<long double> counts;
+    for (const auto& repetition : stats.events) {
+        if (repetition[event] >= 0) {
+            counts.push_back(repetition[event]);
+        }
+    }
+    if (counts.empty()) {
+        return -1;
+    }
+    std::sort(counts.begin(), counts.end());
+    return quantile(counts, 0.5);
+}
+
+
+/**
+ * Prints the instructions per cycle and the misses per element of one sort, if its hardware events were counted.
+ * 
+ * @param stats the statistics of the sort
+ * @param n the size of the sorted array
+*/
+void printEventStats(const TimingStats& stats, int n)
+{
+    if (stats.events.empty()) {
+        return;
+    }
+    long double cycles = medianEvent(stats, 0);
+    long double instructions = medianEvent(stats, 1);
+    cout << "Counters (median):";
+    if (cycles > 0 && instructions >= 0) {
+        cout << " IPC " << instructions / cycles;
+    }
+    for (int e = 2; e < perfEventCount; e++) {
+        long double count = medianEvent(stats, e);
+        if (count >= 0) {
+            cout << ", " << perfEventNames()[e] << " per element " << count / n;
+        }
+    }
+    cout << endl;
+}
+
+
+/**
+ * Writes the median count of every hardware event, the IPC and the misses per element of one sort, each after a comma.
+ * Events that were not counted are left empty.
+ * 
+ * @param outputFile the CSV file
+ * @param stats the statistics of the sort
+ * @param n the size of the sorted array
+*/
+void writeEventStats(std::fstream& outputFile, const TimingStats& stats, int n)
+{
+    std::array<long double, perfEventCount> medians;
+    for (int e = 0; e < perfEventCount; e++) {
+        medians[e] = medianEvent(stats, e);
+        outputFile << ",";
+        if (medians[e] >= 0) {
+            outputFile << medians[e];
+        }
+    }
+    outputFile << ",";
+    if (medians[0] > 0 && medians[1] >= 0) {
+        outputFile << medians[1] / medians[0];
+    }
+    for (int e = 2; e < perfEventCount; e++) {
+        outputFile << ",";
+        if (medians[e] >= 0) {
+            outputFile << medians[e] / n;
+        }
+    }
+}
+
+
+/**
+ * Returns the header row of the CSV file of a suite.
+ * The counter columns of the listings suite are always there, and empty without --perf, so every run of
+ * a suite writes the same columns.
+ * 
+ * @param suite the name of the suite
+ * @return the header, without a line break
+*/
+std::string csvHeader(const std::string& suite)
+{
+    if (suite == "listings") {
+        std::string header = "key,dist,n,threads,algo,reps,min,median,mean,stddev,p95,ci_low,ci_high,vs_best_baseline,best_baseline,min_bytes,bandwidth_gbps,fraction_of_peak";
+        for (const std::string& event : perfEventNames()) {
+            header += "," + event;
+        }
+        header += ",ipc";
+        for (int e = 2; e < perfEventCount; e++) {
+            header += "," + perfEventNames()[e] + "_per_element";
+        }
+        return header + ",backend,backend_threads";
+    }
+    if (suite == "scaling") {
+        return "key,dist,n,algo,baseline,threads,reps,median,ci_low,ci_high,baseline_median,speedup,efficiency";
+    }
+    if (suite == "keyvalue") {
+        return "payload,dist,n,algo,reps,min,median,mean,stddev,p95,ci_low,ci_high";
+    }
+    if (suite == "stages") {
+        return "key,dist,n,algo,p,k,passes,tests,comparisons,swaps";
+    }
+    if (suite == "batch") {
+        return "dist,length,arrays,Listing4Loop,Listing4Batched,Listing4LoopArraysPerSecond,Listing4BatchedArraysPerSecond";
+    }
+    return "dist,length,arrays,Listing4Loop,Listing4Fixed";
+}
+
+
+/**
+ * Returns the CSV file of a suite: --out itself for the listings, and --out with _<suite> before the extension otherwise.
+ * 
+ * @param out the --out file
+ * @param suite the name of the suite
+ * @return the path of the CSV file
+*/
+std::string csvPath(const std::string& out, const std::string& suite)
+{
+    if (suite == "listings") {
+        return out;
+    }
+    size_t dot = out.rfind('.');
+    size_t slash = out.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return out + "_" + suite;
+    }
+    return out.substr(0, dot) + "_" + suite + out.substr(dot);
+}
+
+
+/**
+ * @brief Opens a CSV file for appending, writing the header only if the file is new or empty.
+ * A file that starts with a different header is left untouched, since appending to it would mix columns.
+ * 
+ * @param path the CSV file
+ * @param header the header row
+ * @param file set to the open file
+ * @return true if the file is open and has the given header
+*/
+bool openCsv(const std::string& path, const std::string& header, std::fstream& file)
+{
+    std::string firstLine;
+    std::ifstream existing(path);
+    bool empty = !existing.is_open() || !std::getline(existing, firstLine) || firstLine.empty();
+    existing.close();
+    if (!empty && firstLine != header) {
+        std::cout << "Error: " << path << " has other columns; choose another file with --out" << std::endl;
+        return false;
+    }
+
+    file.open(path, std::ios::out | std::ios::app);
+    if (!file.is_open()) {
+        std::cout << "Error opening file: " << path << std::endl;
+        return false;
+    }
+    if (empty) {
+        file << header << std::endl;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Describes the machine, build and settings of this run as JSON object members.
+ * The revision and compiler flags are those passed in ODD_EVEN_SORT_GIT_REV and ODD_EVEN_SORT_BUILD_FLAGS
+ * at build time. Without them the revision is "unknown" and the flags are rebuilt from the compiler's
+ * predefined macros (__OPTIMIZE__, __AVX2__, _OPENMP), as in "predefined:-O -fopenmp".
+ * 
+ * @param options the parsed command line options
+ * @param argc the number of command line arguments
+ * @param argv the command line arguments
+ * @return the members, without the enclosing braces
+*/
+std::string describeRun(const BenchmarkOptions& options, int argc, char* argv[])
+{
+    std::string cpuModel = "unknown";
+    std::ifstream cpuInfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuInfo, line);) {
+        if (line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos) {
+            cpuModel = line.substr(line.find(':') + 2);
+            break;
+        }
+    }
+
+    std::string host = "unknown";
+#if defined(__unix__) || defined(__APPLE__)
+    char hostName[256] = {};
+    if (gethostname(hostName, sizeof(hostName) - 1) == 0) {
+        host = hostName;
+    }
+#endif
+
+#if defined(__clang__)
+    std::string compiler = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    std::string compiler = std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+    std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#else
+    std::string compiler = "unknown";
+#endif
+
+#ifdef ODD_EVEN_SORT_BUILD_FLAGS
+    std::string flags = ODD_EVEN_SORT_BUILD_FLAGS;
+#else
+    // without the define, reconstruct what the compiler's predefined macros reveal about the flags
+    std::string flags;
+#ifdef __OPTIMIZE__
+    flags += " -O";
+#else
+    flags += " -O0";
+#endif
+#ifdef __AVX2__
+    flags += " -mavx2";
+#endif
+#ifdef _OPENMP
+    flags += " -fopenmp";
+#endif
+#ifdef ODD_EVEN_SORT_PARALLEL_STL
+    flags += " -DODD_EVEN_SORT_PARALLEL_STL";
+#endif
+#ifdef ODD_EVEN_SORT_INSTRUMENT
+    flags += " -DODD_EVEN_SORT_INSTRUMENT";
+#endif
+    flags = "predefined:" + flags.substr(1);
+#endif
+
+#ifdef ODD_EVEN_SORT_GIT_REV
+    std::string revision = ODD_EVEN_SORT_GIT_REV;
+#else
+    std::string revision = "unknown";
+#endif
+
+    std::string command;
+    for (int a = 0; a < argc; a++) {
+        command += (a > 0 ? " " : "") + std::string(argv[a]);
+    }
+
+    auto environment = [](const char* name) {
+        const char* value = std::getenv(name);
+        return value ? jsonString(value) : std::string("null");
+    };
+
+    char started[32] = {};
+    std::time_t now = std::time(nullptr);
+    std::strftime(started, sizeof(started), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::ostringstream metadata;
+    metadata << "\"host\":" << jsonString(host)
+             << ",\"cpu_model\":" << jsonString(cpuModel)
+             << ",\"physical_cores\":" << physicalCoreCount()
+             << ",\"logical_cpus\":" << logicalCpuCount()
+             << ",\"avx2\":" << (cpuHasAVX2() ? "true" : "false")
+             << ",\"compiler\":" << jsonString(compiler)
+             << ",\"flags\":" << jsonString(flags)
+             << ",\"git_rev\":" << jsonString(revision)
+#ifdef _OPENMP
+             << ",\"openmp\":" << _OPENMP
+             << ",\"omp_max_threads\":" << omp_get_max_threads()
+#else
+             << ",\"openmp\":null,\"omp_max_threads\":null"
+#endif
+             << ",\"omp_num_threads\":" << environment("OMP_NUM_THREADS")
+             << ",\"omp_proc_bind\":" << environment("OMP_PROC_BIND")
+             << ",\"omp_places\":" << environment("OMP_PLACES")
+             << ",\"pin\":" << jsonString(options.pin)
+             << ",\"selected_backend\":" << jsonString(parallelBackend)
+             << ",\"numa_nodes\":" << cpuTopology.nodeCount
+             << ",\"seed\":" << options.seed
+             << ",\"warmup\":" << options.warmup
+             << ",\"started\":" << jsonString(started)
+             << ",\"command\":" << jsonString(command);
+    return metadata.str();
+}
+
+
+/**
+ * Appends one result to the JSON Lines file, if --json was given: the suite, the run metadata, the fields
+ * identifying the result, every repetition's time and their summary, and the hardware counts if any.
+ * 
+ * @param suite the name of the suite
+ * @param fields the JSON object members identifying the result, without the enclosing braces
+ * @param stats the timing statistics of the result
+*/
+void writeJsonRecord(const std::string& suite, const std::string& fields, const TimingStats& stats)
+{
+    if (!jsonOutput.is_open()) {
+        return;
+    }
+
+    std::ostringstream record;
+    record << std::setprecision(10);
+    record << "{\"suite\":" << jsonString(suite) << "," << runMetadata << "," << fields << ",\"times\":[";
+    for (size_t r = 0; r < stats.samples.size(); r++) {
+        record << (r > 0 ? "," : "") << jsonNumber(stats.samples[r]);
+    }
+    record << "],\"min\":" << jsonNumber(stats.min) << ",\"median\":" << jsonNumber(stats.median)
+           << ",\"mean\":" << jsonNumber(stats.mean) << ",\"stddev\":" << jsonNumber(stats.stddev)
+           << ",\"p95\":" << jsonNumber(stats.p95)
+           << ",\"ci_low\":" << jsonNumber(stats.ciLow) << ",\"ci_high\":" << jsonNumber(stats.ciHigh);
+    if (!stats.events.empty()) {
+        record << ",\"events\":{";
+        for (int e = 0; e < perfEventCount; e++) {
+            record << (e > 0 ? "," : "") << jsonString(perfEventNames()[e]) << ":[";
+            for (size_t r = 0; r < stats.events.size(); r++) {
+                record << (r > 0 ? "," : "");
+                if (stats.events[r][e] >= 0) {
+                    record << stats.events[r][e];
+                } else {
+                    record << "null";
+                }
+            }
+            record << "]";
+        }
+        record << "}";
+    }
+    record << "}";
+    jsonOutput << record.str() << std::endl;
+}
+
+
+/**
+ * Quotes and escapes a string for JSON.
+ * 
+ * @param text the string
+ * @return the JSON string literal
+*/
+std::string jsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+
+/**
+ * Formats a number for JSON, which has no literal for infinities and NaN.
+ * 
+ * @param value the number
+ * @return the number with 10 significant digits, or null if it is not finite
+*/
+std::string jsonNumber(long double value)
+{
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    std::ostringstream number;
+    number << std::setprecision(10) << value;
+    return number.str();
+}
+
+
+/**
+ * Returns the number of threads the next parallel region will use.
+ * 
+ * @return the OpenMP thread count, or 1 without OpenMP
+*/
+int currentThreadCount()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+
+/**
+ * Prints the total work counted by an instrumented build in the last sort, if it was an instrumented listing.
+*/
+void printStageCounts()
+{
+    if (!Instrumentation::enabled) {
+        return;
+    }
+    StageCounters::Counts total{};
+    for (const auto& row : StageCounters::counts) {
+        for (const auto& counts : row) {
+            total.passes += counts.passes;
+            total.tests += counts.tests;
+            total.comparisons += counts.comparisons;
+            total.swaps += counts.swaps;
+        }
+    }
+    if (total.passes == 0) {
+        return;
+    }
+    cout << "Work: " << total.passes << " passes, " << total.tests << " index tests, "
+         << total.comparisons << " comparisons, " << total.swaps << " swaps" << endl;
+}
+
+
+/**
+ * Writes one row per (p,k) stage of the last sort to the stage CSV of an instrumented build.
+ * 
+ * @param keyType the name of the key type
+ * @param dist the input distribution
+ * @param n the size of the sorted array
+ * @param algo the name of the listing
+*/
+void writeStageCounts(const std::string& keyType, const std::string& dist, int n, const std::string& algo)
+{
+    if (!Instrumentation::enabled || !stageOutput.is_open()) {
+        return;
+    }
+    for (int p = StageCounters::levels; p--;) {
+        for (int k = StageCounters::levels; k--;) {
+            const StageCounters::Counts& counts = StageCounters::counts[p][k];
+            if (counts.passes > 0) {
+                stageOutput << keyType << "," << dist << "," << n << "," << algo << "," << (1L << p) << "," << (1L << k) << ","
+                            << counts.passes << "," << counts.tests << "," << counts.comparisons << "," << counts.swaps << std::endl;
+            }
+        }
+    }
+}
+
+
+/**
+ * Executes a key-plus-payload sorting function repeatedly and measures the execution times.
+ * Every run sorts fresh copies of the keys and payloads.
+ * The output of the last run is checked by verifyKeyValue(), and the program stops if it is wrong.
+ * 
+ * @tparam K the key type
+ * @tparam V the payload type
+ * @param keys the keys to be sorted
+ * @param values the payloads moved along with the keys, the original index of every key
+ * @param n the size of the arrays
+ * @param sortFunc the sorting function
+ * @param sortFuncName the name of the sorting function
+ * @param options the warmup and repetition settings
+ * @return the timing statistics
+*/
+template<typename K, typename V>
+TimingStats executeKeyValueListing(K keys[], V values[], int n, K* (*sortFunc)(K[], V[], int), const std::string& sortFuncName, const BenchmarkOptions& options)
+{
+    // Copy the arrays
+    K* keysCopied = new K[n];
+    V* valuesCopied = new V[n];
+
+    TimingStats stats = measureRuns([&] { std::copy(keys, keys + n, keysCopied); std::copy(values, values + n, valuesCopied); },
+                                    [&] { sortFunc(keysCopied, valuesCopied, n); },
+                                    options);
+    verifyKeyValue(keys, keysCopied, valuesCopied, n, sortFuncName);
+
+    printTimingStats(sortFuncName, stats);
+
+    // Deallocate dynamic arrays
+    delete[] keysCopied;
+    delete[] valuesCopied;
+
+    return stats;
+}
+
+
+/**
+ * @brief Checks a key-plus-payload listing's output and stops the program if it is wrong.
+ * The keys must come out in ascending order, and the payloads, seeded with the original index of every key,
+ * must be a permutation of the indices in which every payload still indexes a key equal to the one it sits next to.
+ * 
+ * @tparam K the key type
+ * @tparam V the payload type
+ * @param keys the unsorted keys
+ * @param sortedKeys the listing's keys
+ * @param sortedValues the listing's payloads
+ * @param n the size of the arrays
+ * @param sortFuncName the name of the sorting function, printed on a mismatch
+*/
+template<typename K, typename V>
+void verifyKeyValue(const K keys[], const K sortedKeys[], const V sortedValues[], int n, const std::string& sortFuncName)
+{
+    std::vector<bool> seen(n, false);
+    for (int i = 0; i < n; i++) {
+        if (i > 0 && sortedKeys[i] < sortedKeys[i-1]) {
+            cout << "Error: " << sortFuncName << " sorted " << n << " keys incorrectly, position " << i
+                 << " holds " << sortedKeys[i] << " after " << sortedKeys[i-1] << endl;
+            std::exit(EXIT_FAILURE);
+        }
+        V row = sortedValues[i];
+        if (row >= static_cast<V>(n) || seen[row] || keys[row] < sortedKeys[i] || sortedKeys[i] < keys[row]) {
+            cout << "Error: " << sortFuncName << " separated a payload from its key, position " << i
+                 << " holds key " << sortedKeys[i] << " with payload " << row << endl;
+            std::exit(EXIT_FAILURE);
+        }
+        seen[row] = true;
+    }
+}
+
+
+/**
+ * @brief Sorts row ids by random keys with the key-plus-payload listings and writes the execution times.
+ * Each size is sorted in the array-of-structures layout (KeyValue pairs through the generic listings)
+ * and in the structure-of-arrays layout (separate key and payload arrays), so the two can be compared.
+ * 
+ * @tparam K the key type
+ * @tparam V the payload type
+ * @param valueType the name of the payload type written to the output file
+ * @param options the sizes and input distribution
+ * @param generator the random number generator
+ * @param outputFile the CSV file the execution times are appended to
+*/
+template<typename K, typename V>
+void benchmarkKeyValue(const std::string& valueType, const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile)
+{
+    typedef KeyValue<K, V> Pair;
+    typedef KeyValueOrder<K, V> PairOrder;
+
+    for (long size : options.sizes) {
+
+            int n = size;
+            K* keys = new K[n];
+            V* values = new V[n];
+            Pair* pairs = new Pair[n];
+            generateKeys(keys, n, options.dist, generator());
+            // Every payload is the original index of its key, so verifyKeyValue() can trace it back
+            for (int i = 0; i < n; i++) {
+                values[i] = i;
+                pairs[i] = {keys[i], values[i]};
+            }
+
+            cout << "Sorting row ids of type " << valueType << " by keys of length n = " << n << endl;
+
+            std::vector<std::pair<std::string, TimingStats>> results = {
+                {"Listing3AoS", executeListing(pairs, n, sortListing3<Pair, PairOrder>, "Listing3AoS", options)},
+                {"Listing4AoS", executeListing(pairs, n, sortListing4<Pair, PairOrder>, "Listing4AoS", options)},
+                {"Listing3SoA", executeKeyValueListing(keys, values, n, sortListing3KeyValue<K, V>, "Listing3SoA", options)},
+                {"Listing4SoA", executeKeyValueListing(keys, values, n, sortListing4KeyValue<K, V>, "Listing4SoA", options)}
+            };
+            for (const auto& result : results) {
+                outputFile << valueType << "," << options.dist << "," << n << "," << result.first << ",";
+                writeTimingStats(outputFile, result.second);
+                outputFile << std::endl;
+
+                writeJsonRecord("keyvalue", "\"payload\":" + jsonString(valueType) + ",\"dist\":" + jsonString(options.dist) +
+                                ",\"n\":" + std::to_string(n) + ",\"algo\":" + jsonString(result.first), result.second);
+            }
+
+            // Deallocate the dynamic arrays
+            delete[] keys;
+            delete[] values;
+            delete[] pairs;
+        }
+}
+
+
+/**
+ * @brief Sorts many independent small arrays of random integers and writes the throughput.
+ * For every length and count, the arrays are sorted once by calling sortListing4 in a loop and once
+ * by sortBatchTransposed on the same arrays stored in the transposed layout.
+ * Only the sorting is timed; the arrays are transposed beforehand. The median time of the repetitions is written.
+ * The output of the last run of each is checked array by array against std::sort, and the program stops if it is wrong.
+ * 
+ * @param options the array lengths, the numbers of arrays (options.sizes) and the input distribution
+ * @param generator the random number generator
+ * @param outputFile the CSV file the results are appended to
+*/
+void benchmarkBatch(const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile)
+{
+    for (int length : options.batchLengths) {
+        for (long arrayCount : options.sizes) {
+
+            long batches = (arrayCount + batchLanes - 1) / batchLanes;
+            int* arrays = new int[arrayCount * length];
+            int* data = new int[batches * batchLanes * length];
+            generateKeys(arrays, arrayCount * length, options.dist, generator());
+            interleaveArrays(arrays, data, length, arrayCount);
+
+            cout << "Sorting " << arrayCount << " arrays of length " << length << endl;
+
+            int* arraysCopied = new int[arrayCount * length];
+            int* dataCopied = new int[batches * batchLanes * length];
+
+            TimingStats loop = measureRuns([&] { std::copy(arrays, arrays + arrayCount * length, arraysCopied); },
+                                           [&] {
+                                               for (long a = 0; a < arrayCount; a++) {
+                                                   sortListing4(arraysCopied + a * length, length);
+                                               }
+                                           },
+                                           options);
+            for (long a = 0; a < arrayCount; a++) {
+                verifySorted(arrays + a * length, arraysCopied + a * length, length, "Listing4Loop");
+            }
+            TimingStats batched = measureRuns([&] { std::copy(data, data + batches * batchLanes * length, dataCopied); },
+                                              [&] { sortBatchTransposed(dataCopied, length, batches); },
+                                              options);
+            deinterleaveArrays(dataCopied, arraysCopied, length, arrayCount);
+            for (long a = 0; a < arrayCount; a++) {
+                verifySorted(arrays + a * length, arraysCopied + a * length, length, "Listing4Batched");
+            }
+
+            long double loopRate = arrayCount / loop.median;
+            long double batchRate = arrayCount / batched.median;
+            cout << "Listing4Loop: " << loopRate << " arrays per second" << endl;
+            cout << "Listing4Batched: " << batchRate << " arrays per second" << endl;
+
+            outputFile << options.dist << "," << length << "," << arrayCount << "," << loop.median << "," << batched.median << ","
+                       << loopRate << "," << batchRate << std::endl;
+
+            std::string fields = "\"dist\":" + jsonString(options.dist) + ",\"length\":" + std::to_string(length) +
+                                 ",\"arrays\":" + std::to_string(arrayCount);
+            writeJsonRecord("batch", fields + ",\"algo\":\"Listing4Loop\"", loop);
+            writeJsonRecord("batch", fields + ",\"algo\":\"Listing4Batched\"", batched);
+
+            // Deallocate the dynamic arrays
+            delete[] arrays;
+            delete[] data;
+            delete[] arraysCopied;
+            delete[] dataCopied;
+        }
+    }
+}
+
+
+/**
+ * Sorts many fixed-length arrays of random integers with Listing 4 and with the compile-time network of the same length.
+ * The median time of the repetitions is written.
+ * The output of the last run of each is checked array by array against std::sort, and the program stops if it is wrong.
+ * 
+ * @tparam N the length of every array
+ * @param options the numbers of arrays (options.sizes) and the input distribution
+ * @param generator the random number generator
+ * @param outputFile the CSV file the results are appended to
+*/
+template<int N>
+void benchmarkFixedLength(const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile)
+{
+    for (long arrayCount : options.sizes) {
+
+        int* arrays = new int[arrayCount * N];
+        int* arraysCopied = new int[arrayCount * N];
+        generateKeys(arrays, arrayCount * N, options.dist, generator());
+        auto restore = [&] { std::copy(arrays, arrays + arrayCount * N, arraysCopied); };
+
+        cout << "Sorting " << arrayCount << " arrays of fixed length " << N << endl;
+
+        TimingStats loop = measureRuns(restore,
+                                       [&] {
+                                           for (long a = 0; a < arrayCount; a++) {
+                                               sortListing4(arraysCopied + a * N, N);
+                                           }
+                                       },
+                                       options);
+        for (long a = 0; a < arrayCount; a++) {
+            verifySorted(arrays + a * N, arraysCopied + a * N, N, "Listing4Loop");
+        }
+        TimingStats fixed = measureRuns(restore,
+                                        [&] {
+                                            for (long a = 0; a < arrayCount; a++) {
+                                                sortFixed<N>(arraysCopied + a * N);
+                                            }
+                                        },
+                                        options);
+        for (long a = 0; a < arrayCount; a++) {
+            verifySorted(arrays + a * N, arraysCopied + a * N, N, "Listing4Fixed");
+        }
+
+        printTimingStats("Listing4Loop", loop);
+        printTimingStats("Listing4Fixed", fixed);
+
+        outputFile << options.dist << "," << N << "," << arrayCount << "," << loop.median << "," << fixed.median << std::endl;
+
+        std::string fields = "\"dist\":" + jsonString(options.dist) + ",\"length\":" + std::to_string(N) +
+                             ",\"arrays\":" + std::to_string(arrayCount);
+        writeJsonRecord("fixed", fields + ",\"algo\":\"Listing4Loop\"", loop);
+        writeJsonRecord("fixed", fields + ",\"algo\":\"Listing4Fixed\"", fixed);
+
+        // Deallocate the dynamic arrays
+        delete[] arrays;
+        delete[] arraysCopied;
+    }
+}
+
+
+/**
+ * Benchmarks the compile-time networks for lengths 16, 32 and 64 against the Listing 4 loop nest.
+ * 
+ * @param options the numbers of arrays (options.sizes) and the input distribution
+ * @param generator the random number generator
+ * @param outputFile the CSV file the results are appended to
+*/
+void benchmarkFixed(const BenchmarkOptions& options, std::mt19937& generator, std::fstream& outputFile)
+{
+    benchmarkFixedLength<16>(options, generator, outputFile);
+    benchmarkFixedLength<32>(options, generator, outputFile);
+    benchmarkFixedLength<64>(options, generator, outputFile);
+}
+
+
+/**
+ * Sorts an array using Listing 1.
+ * 
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+ * @see R. Sedgewick, "Algorithms in C++, 1992," ed: Addison-Wesley.
+*/
+template<typename T, typename Compare>
+T* sortListing1(T A[], int n)
+{
+    Compare comp{};
+    for (int p = 1; p < n; p += p) 
+        for (int k = p; k > 0; k /= 2) {
+            ODD_EVEN_SORT_COUNT(stage(p, k));
+            for (int j = k % p; j + k < n; j += 2 * k) {
+                ODD_EVEN_SORT_COUNT(pass());
+                for (int i = 0; i < n-j-k; i++) {
+                    ODD_EVEN_SORT_COUNT(test());
+                    if ((j+i) / (p+p) == (j+i+k)/(p+p)) {
+                        ODD_EVEN_SORT_COUNT(comparison());
+                        if (comp(A[j+i+k], A[j+i])) {
+                            ODD_EVEN_SORT_COUNT(swap());
+                            swap(A[j+i], A[j+i+k]);
+                        }
+                    }
+                }
+            }
+        }
+
+    return A;
+}
+
+
+/**
+ * @brief Sorts an array using Listing 1 in parallel.
+ * "#pragma omp parallel" opens a single team of threads for the whole sort; every thread walks the p and k loops.
+ * "#pragma omp for" shares out one loop of each (p,k) stage, over the blocks of 2p elements, because a pair is only
+ * compared inside its own block; within a block the pairs keep the order of the serial Listing 1.
+ * The blocks never overlap, so no critical section is needed, and the barrier at the end of "omp for" ends the stage.
+ * "shared()" means that the variables inside it are shared between the threads.
+ * "default(none)" means that all variables must be explicitly declared as shared or private.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing1Parallel(T A[], int n)
+{
+    Compare comp{};
+    noteOpenMPBackend();
+
+    #pragma omp parallel shared(A, n, comp) default(none)
+    for (int p = 1; p < n; p *= 2) 
+    {
+        for (int k = p; k > 0; k /= 2) 
+        {
+            // A pair is only compared inside its block of 2p elements, so the blocks are independent
+            int blocks = (n + 2*p - 1) / (2*p);
+            #pragma omp for
+            for (int b = 0; b < blocks; b++)
+            {
+                int first = b * 2*p;
+                int last = std::min(n, first + 2*p);
+                for (int j = k % p; j + k < last; j += 2 * k) 
+                {
+                    for (int i = std::max(0, first - j); j+i+k < last; i++)
+                    {
+                        if (comp(A[j+i+k], A[j+i]))
+                        {
+                            swap(A[j+i], A[j+i+k]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return A;
+}
+
+
+/**
+ * Sorts an array using Listing 2.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing2(T A[], int n)
+{
+    Compare comp{};
+    for(int p = 1; p < n; p *= 2) 
+        for(int k = p; k > 0; k /= 2) {
+            ODD_EVEN_SORT_COUNT(stage(p, k));
+            for(int j = k % p; j + k < 2*p; j += 2*k) 
+                for(int i = 0; i < k; i++) {
+                    ODD_EVEN_SORT_COUNT(pass());
+                    for(int m = i + j; m < n - k; m += 2*p) {
+                        ODD_EVEN_SORT_COUNT(comparison());
+                        if(comp(A[m+k], A[m])) {
+                            ODD_EVEN_SORT_COUNT(swap());
+                            swap(A[m], A[m+k]);
+                        }
+                    }
+                }
+        }
+
+    return A;
+}
+
+
+/**
+ * @brief Sorts an array using Listing 2 in parallel.
+ * "#pragma omp parallel" opens a single team of threads for the whole sort; every thread walks the p, k, j and i loops.
+ * "#pragma omp for" shares out the innermost m loop. The pairs (m, m+k) of a (p,k) stage are disjoint, so no critical
+ * section is needed and "nowait" lets a thread move on to the next chain; "#pragma omp barrier" ends the stage.
+ * "shared()" means that the variables inside it are shared between the threads.
+ * "default(none)" means that all variables must be explicitly declared as shared or private.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing2Parallel(T A[], int n)
+{
+    Compare comp{};
+    noteOpenMPBackend();
+    #pragma omp parallel shared(A, n, comp) default(none)
+    for(int p = 1; p < n; p *= 2) 
+    {
+        for(int k = p; k > 0; k /= 2) 
+        {
+            for(int j = k % p; j + k < 2*p; j += 2*k) 
+            {
+                for(int i = 0; i < k; i++) 
+                {
+                    #pragma omp for nowait
+                    for(int m = i + j; m < n - k; m += 2*p) 
+                    {
+                        if(comp(A[m+k], A[m])) 
+                        {
+                            swap(A[m], A[m+k]);
+                        }
+                    }
+                }
+            }
+            #pragma omp barrier
+        }
+    }
+    return A;
+}
+
+
+/**
+ * @brief Sorts an array using Listing 2 in parallel without locks.
+ * Inside one (p,k) stage the comparator pairs (m, m+k) are disjoint, so no critical section is needed.
+ * The j, i and m loops of a stage are flattened into one comparator index space, ordered by m-round,
+ * then j, then i, so consecutive indices touch consecutive elements.
+ * runTeam() opens a single team of threads for the whole sort, on the selected backend, and each thread takes
+ * one contiguous, equally sized slice of every stage's index space.
+ * The team's stage barrier makes every thread finish the current stage before any thread starts the next one.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing2ParallelAlt(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    bool vectorised = useAVX2;
+
+    runTeam([&](auto& team) { listing2AltStages(A, n, comp, vectorised, team); });
+
+    return A;
+}
+
+
+/**
+ * @brief Applies every stage of the lock-free Listing 2 as one thread of a team.
+ * Each thread takes one contiguous, equally sized slice of every stage's flattened comparator index space,
+ * and team.stage() separates the stages.
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+ * @param team the calling thread's index, the team size and the barrier
+*/
+template<typename T, typename Compare, typename Team>
+void listing2AltStages(T A[], int n, Compare comp, bool useAVX2, Team& team)
+{
+    for(int p = 1; p < n; p *= 2)
+    {
+        for(int k = p; k > 0; k /= 2)
+        {
+            // Comparator c is i = c % k of chain j = (k % p) + 2k * (c / k % chains) in m-round c / k / chains
+            long first = k % p;
+            long chains = first + k < 2*p ? (2*p - k - first + 2*k - 1) / (2*k) : 0;
+            long rounds = first < n - k ? (n - k - first + 2*p - 1) / (2*p) : 0;
+            long total = rounds * chains * k;
+
+            team.stage([&](long threadId, long threadCount) {
+                long begin = total * threadId / threadCount;
+                long end = total * (threadId + 1) / threadCount;
+
+                for(long c = begin; c < end; c = (c / k + 1) * k)
+                {
+                    long m = first + 2*k * (c / k % chains) + 2*p * (c / k / chains);
+                    long i = c % k;
+                    long len = std::min(std::min<long>(k, n-k-m), i + end - c) - i;
+                    if(len <= 0)
+                        continue;
+                    compareExchangeRunVector(A + m + i, A + m + i + k, len, comp, useAVX2);
+                }
+            });
+        }
+    }
+}
+
+
+/**
+ * Sorts an array using Listing 3.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing3(T A[], int n)
+{
+    Compare comp{};
+    for (int p = 1; p < n; p *= 2) 
+        for (int k = p; k > 0; k /= 2) {
+            ODD_EVEN_SORT_COUNT(stage(p, k));
+            ODD_EVEN_SORT_COUNT(pass());
+            for (int j = k % p; j + k < n; j += 2*k) 
+                for (int i = std::min(k, n-j-k); i--;) {
+                    ODD_EVEN_SORT_COUNT(test());
+                    if ((j+i)/(2*p) == (j+i+k)/(2*p)) {
+                        ODD_EVEN_SORT_COUNT(comparison());
+                        if (comp(A[j+i+k], A[j+i])) {
+                            ODD_EVEN_SORT_COUNT(swap());
+                            std::swap(A[j+i], A[j+i+k]);
+                        }
+                    }
+                }
+        }
+
+    return A;
+}
+
+
+/**
+ * @brief Sorts an array using Listing 3 in parallel.
+ * "#pragma omp parallel" opens a single team of threads for the whole sort; every thread walks the p, k and j loops.
+ * "#pragma omp for" shares out the innermost i loop. The pairs (j+i, j+i+k) of a (p,k) stage are disjoint, so no critical
+ * section is needed and "nowait" lets a thread move on to the next group; "#pragma omp barrier" ends the stage.
+ * "shared()" means that the variables inside it are shared between the threads.
+ * "default(none)" means that all variables must be explicitly declared as shared or private.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing3Parallel(T A[], int n)
+{
+    Compare comp{};
+    noteOpenMPBackend();
+    #pragma omp parallel shared(A, n, comp) default(none)
+    for (int p = 1; p < n; p *= 2) 
+    {
+        for (int k = p; k > 0; k /= 2) 
+        {
+            for (int j = k % p; j + k < n; j += 2*k) 
+            {
+                int pairs = std::min(k, n-j-k);
+                #pragma omp for nowait
+                for (int i = 0; i < pairs; i++) 
+                {
+                    if ((j+i)/(2*p) == (j+i+k)/(2*p)) 
+                    {
+                        if (comp(A[j+i+k], A[j+i])) 
+                        {
+                            std::swap(A[j+i], A[j+i+k]);
+                        }
+                    }
+                }
+            }
+            #pragma omp barrier
+        }
+    }
+
+    return A;
+}
+
+
+/**
+ * Sorts an array using Listing 4.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4(T A[], int n)
+{
+    Compare comp{};
+    for(int p = 1; p < n; p *= 2)
+        for(int k = p; k > 0; k /= 2) {
+            ODD_EVEN_SORT_COUNT(stage(p, k));
+            ODD_EVEN_SORT_COUNT(pass());
+            for(int j = k & (p - 1); j + k < n; j += 2*k) {
+                ODD_EVEN_SORT_COUNT(test());
+                if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
+                    for(int i = std::min(k, n-j-k); i--;) {
+                        ODD_EVEN_SORT_COUNT(comparison());
+                        if(comp(A[j+i+k], A[j+i])) {
+                            ODD_EVEN_SORT_COUNT(swap());
+                            std::swap(A[j+i], A[j+i+k]);
+                        }
+                    }
+            }
+        }
+
+    return A;
+}
+
+
+/**
+ * @brief Sorts an array using Listing 4 in parallel.
+ * The (p,k) stages depend on each other, so only the comparators inside one stage may run concurrently.
+ * runTeam() opens a single team of threads for the whole sort, on the selected backend; every thread walks the p and k loops.
+ * Each thread applies its slice of every stage with applyLevelSlice().
+ * The team's stage barrier makes every thread finish the current stage before any thread starts the next one.
+ * The comparators of a stage are disjoint, so no critical section is needed and the output is identical to Listing 4.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4Parallel(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    bool vectorised = useAVX2;
+
+    runTeam([&](auto& team) { listing4Stages(A, n, comp, vectorised, team); });
+
+    return A;
+}
+
+
+/**
+ * Applies every (p,k) stage of Listing 4 as one thread of a team: its slice of the stage with applyLevelSlice(),
+ * in team.stage() so that the stage is finished before the next.
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+ * @param team the calling thread's index, the team size and the barrier
+*/
+template<typename T, typename Compare, typename Team>
+void listing4Stages(T A[], int n, Compare comp, bool useAVX2, Team& team)
+{
+    for(int p = 1; p < n; p *= 2)
+    {
+        for(int k = p; k > 0; k /= 2)
+        {
+            team.stage([&](long threadId, long threadCount) {
+                applyLevelSlice(A, n, p, k, comp, useAVX2, threadId, threadCount);
+            });
+        }
+    }
+}
+
+
+/**
+ * @brief Applies one thread's share of a (p,k) stage of Listing 4.
+ * The comparators of the stage are numbered group by group (group j covers the run A[j..j+k) against A[j+k..j+2k))
+ * and the thread takes one contiguous, equally sized slice of that numbering.
+ * Comparator c is lane c % k of the group starting at j = (k & (p - 1)) + 2k * (c / k).
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param p the current round of Listing 4
+ * @param k the level within the round
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+ * @param threadId the index of the calling thread
+ * @param threadCount the number of threads sharing the stage
+*/
+template<typename T, typename Compare>
+void applyLevelSlice(T A[], int n, int p, int k, Compare comp, bool useAVX2, long threadId, long threadCount)
+{
+    long first = k & (p - 1);
+    long groups = first + k < n ? (n - k - first + 2*k - 1) / (2*k) : 0;
+    long total = groups * k;
+    long begin = total * threadId / threadCount;
+    long end = total * (threadId + 1) / threadCount;
+
+    for(long c = begin; c < end; c = (c / k + 1) * k)
+    {
+        long j = first + 2*k * (c / k);
+        if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
+        {
+            long i = c % k;
+            long len = std::min(std::min<long>(k, n-j-k), i + end - c) - i;
+            if(len <= 0)
+                continue;
+            compareExchangeRunVector(A + j + i, A + j + i + k, len, comp, useAVX2);
+        }
+    }
+}
+
+
+/**
+ * @brief Sorts an array using a per-thread local sort followed by the upper rounds of Listing 4 in parallel.
+ * The array is split into one aligned chunk per thread, of the smallest power-of-two length that covers it.
+ * The rounds p < chunk of Listing 4 never compare across such chunks and only leave each chunk sorted,
+ * so every thread sorts its own chunk with std::sort while the data is in its cache.
+ * The remaining rounds p >= chunk merge the sorted runs exactly as sortListing4Parallel does.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4Hybrid(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    bool vectorised = useAVX2;
+
+    runTeam([&](auto& team) { listing4HybridStages(A, n, comp, vectorised, team); });
+
+    return A;
+}
+
+
+/**
+ * Sorts the calling thread's chunk and then applies the rounds p >= chunk of Listing 4 as one thread of a team,
+ * with the local sort and every stage each one team.stage().
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+ * @param team the calling thread's index, the team size and the barrier
+*/
+template<typename T, typename Compare, typename Team>
+void listing4HybridStages(T A[], int n, Compare comp, bool useAVX2, Team& team)
+{
+    long chunk = 1;
+    while(chunk * team.threadCount < n)
+        chunk *= 2;
+
+    team.stage([&](long threadId, long) {
+        long begin = std::min<long>(n, chunk * threadId);
+        long end = std::min<long>(n, begin + chunk);
+        std::sort(A + begin, A + end, comp);
+    });
+
+    for(int p = chunk; p < n; p *= 2)
+    {
+        for(int k = p; k > 0; k /= 2)
+        {
+            team.stage([&](long threadId, long threadCount) {
+                applyLevelSlice(A, n, p, k, comp, useAVX2, threadId, threadCount);
+            });
+        }
+    }
+}
+
+
+/**
+ * Sorts an array using the lock-free Listing 2 on the persistent thread pool instead of an OpenMP team.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing2ParallelAltPool(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    runOnThreadPool([&](PoolTeam& team) { listing2AltStages(A, n, comp, useAVX2, team); });
+    return A;
+}
+
+
+/**
+ * Sorts an array using Listing 4 in parallel on the persistent thread pool instead of an OpenMP team.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4ParallelPool(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    runOnThreadPool([&](PoolTeam& team) { listing4Stages(A, n, comp, useAVX2, team); });
+    return A;
+}
+
+
+/**
+ * Sorts an array using the hybrid engine on the persistent thread pool instead of an OpenMP team.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4HybridPool(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    runOnThreadPool([&](PoolTeam& team) { listing4HybridStages(A, n, comp, useAVX2, team); });
+    return A;
+}
+
+
+/**
+ * Returns the calling thread's index and team size in the enclosing OpenMP parallel region.
+ * 
+ * @return the team, of one thread without OpenMP
+*/
+OpenMPTeam openMPTeam()
+{
+    OpenMPTeam team;
+#ifdef _OPENMP
+    team.threadId = omp_get_thread_num();
+    team.threadCount = omp_get_num_threads();
+#endif
+    return team;
+}
+
+
+/**
+ * @brief Runs a task on every thread of a team of the selected backend and returns when all have finished.
+ * The task is called with the calling thread's team: an OpenMPTeam in one parallel region, a PoolTeam on the
+ * persistent thread pool, or a single StdExecutionTeam that runs every stage under std::execution::par.
+ * The stage loops only use the team's threadId, threadCount, stage() and single(), so they run unchanged on each.
+ * The backend and team size that actually ran are left in backendUsed; an OpenMP region of a build without
+ * OpenMP is reported as serial.
+ * 
+ * @param task a callable taking any of the team types by reference
+*/
+template<typename Task>
+void runTeam(Task task)
+{
+    if (parallelBackend == "threads") {
+        runOnThreadPool([&](PoolTeam& team) { task(team); });
+        return;
+    }
+    if (parallelBackend == "std") {
+        StdExecutionTeam team;
+        team.threadCount = backendThreadCount();
+        task(team);
+        backendUsed = {"std", (int)team.threadCount};
+        return;
+    }
+
+    int threads = 1;
+    #pragma omp parallel default(none) shared(task, threads)
+    {
+        OpenMPTeam team = openMPTeam();
+        if (team.threadId == 0) {
+            threads = team.threadCount;
+        }
+        task(team);
+    }
+#ifdef _OPENMP
+    backendUsed = {"openmp", threads};
+#else
+    backendUsed = {"serial", threads};
+#endif
+}
+
+
+/**
+ * Returns the backend the parallel engines run on unless --backend says otherwise: ODD_EVEN_SORT_BACKEND if
+ * the build defines it, else OpenMP, or the thread pool when built without OpenMP.
+ * 
+ * @return openmp, threads or std
+*/
+std::string defaultBackend()
+{
+#if defined(ODD_EVEN_SORT_BACKEND)
+    return ODD_EVEN_SORT_BACKEND;
+#elif defined(_OPENMP)
+    return "openmp";
+#else
+    return "threads";
+#endif
+}
+
+
+/**
+ * Tells whether this build can run the parallel engines on a backend.
+ * 
+ * @param backend openmp, threads or std
+ * @return true if the backend is compiled in: OpenMP needs -fopenmp, std needs ODD_EVEN_SORT_PARALLEL_STL and <execution>
+*/
+bool backendAvailable(const std::string& backend)
+{
+    if (backend == "openmp") {
+#ifdef _OPENMP
+        return true;
+#else
+        return false;
+#endif
+    }
+    if (backend == "std") {
+#if defined(ODD_EVEN_SORT_PARALLEL_STL) && defined(__cpp_lib_execution)
+        return true;
+#else
+        return false;
+#endif
+    }
+    return backend == "threads";
+}
+
+
+/**
+ * Returns the number of threads the selected backend runs a team with.
+ * 
+ * @return OpenMP's thread count, or --threads (by default one per logical CPU) for the thread pool and std::execution
+*/
+int backendThreadCount()
+{
+    if (parallelBackend == "openmp") {
+        return currentThreadCount();
+    }
+    return requestedThreads > 0 ? requestedThreads : logicalCpuCount();
+}
+
+
+/**
+ * Records in backendUsed that an engine written directly against OpenMP ran, which is serial without OpenMP.
+*/
+void noteOpenMPBackend()
+{
+#ifdef _OPENMP
+    backendUsed = {"openmp", omp_get_max_threads()};
+#else
+    backendUsed = {"serial", 1};
+#endif
+}
+
+
+/**
+ * Prints the backend and thread count a parallel engine actually ran with; serial listings print nothing.
+ * 
+ * @param run the backend of the last sort
+*/
+void printBackend(const BackendRun& run)
+{
+    if (run.name.empty()) {
+        return;
+    }
+    cout << "Backend: " << run.name << ", " << run.threads << (run.threads == 1 ? " thread" : " threads") << endl;
+}
+
+
+/**
+ * @brief Waits until every thread of the barrier has arrived.
+ * Spins for barrierSpinLimit iterations, then sleeps on a futex (or yields where there is none).
+ * The releasing store and the sleeper count are sequentially consistent, so a thread that goes to sleep
+ * either sees the release or is woken by it.
+ * 
+ * @param barrier the barrier
+ * @param localSense the calling thread's sense, flipped on every episode
+*/
+void barrierWait(SpinFutexBarrier& barrier, int& localSense)
+{
+    localSense = 1 - localSense;
+    if (barrier.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        barrier.remaining.store(barrier.threads, std::memory_order_relaxed);
+        barrier.sense.store(localSense);
+        if (barrier.sleepers.load() > 0) {
+#ifdef ODD_EVEN_SORT_HAVE_FUTEX
+            syscall(SYS_futex, reinterpret_cast<int*>(&barrier.sense), FUTEX_WAKE_PRIVATE, std::numeric_limits<int>::max(), nullptr, nullptr, 0);
+#endif
+        }
+        return;
+    }
+
+    for (int spin = 0; spin < barrierSpinLimit; spin++) {
+        if (barrier.sense.load(std::memory_order_acquire) == localSense) {
+            return;
+        }
+#ifdef ODD_EVEN_SORT_HAVE_AVX2
+        _mm_pause();
+#endif
+    }
+
+    barrier.sleepers.fetch_add(1);
+    while (barrier.sense.load() != localSense) {
+#ifdef ODD_EVEN_SORT_HAVE_FUTEX
+        syscall(SYS_futex, reinterpret_cast<int*>(&barrier.sense), FUTEX_WAIT_PRIVATE, 1 - localSense, nullptr, nullptr, 0);
+#else
+        std::this_thread::yield();
+#endif
+    }
+    barrier.sleepers.fetch_sub(1);
+}
+
+
+/**
+ * Prepares a barrier for a number of threads. No thread may be waiting on it.
+ * 
+ * @param barrier the barrier
+ * @param threads the number of threads that will arrive in every episode
+*/
+void resetBarrier(SpinFutexBarrier& barrier, int threads)
+{
+    barrier.threads = threads;
+    barrier.remaining.store(threads);
+    barrier.sense.store(0);
+    barrier.sleepers.store(0);
+}
+
+
+/**
+ * Waits at the pool's barrier and, if timeBarriers is set, records how long the calling thread waited.
+*/
+void PoolTeam::barrier()
+{
+    if (!timeBarriers) {
+        barrierWait(pool->barrier, *sense);
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    barrierWait(pool->barrier, *sense);
+    auto end = std::chrono::steady_clock::now();
+
+    BarrierStats& stats = pool->stats[threadId];
+    stats.barriers++;
+    stats.waitSeconds += std::chrono::duration<long double>(end - start).count();
+}
+
+
+/**
+ * Returns the process-wide thread pool, started or restarted with the requested number of threads.
+ * 
+ * @return the pool, with requestedThreads threads or one per logical CPU
+*/
+ThreadPool& sharedThreadPool()
+{
+    ThreadPool& pool = threadPool;
+    int threads = requestedThreads > 0 ? requestedThreads : logicalCpuCount();
+    if (pool.threadCount != threads) {
+        stopThreadPool(pool);
+        startThreadPool(pool, threads);
+    }
+    return pool;
+}
+
+
+/**
+ * Starts the workers of a stopped pool, pinning worker t to the CPU --pin gives thread t, or else to logical CPU t
+ * (modulo the number of CPUs). The calling thread is thread 0 and is only pinned by --pin.
+ * 
+ * @param pool the pool
+ * @param threads the team size, including the calling thread
+*/
+void startThreadPool(ThreadPool& pool, int threads)
+{
+    pool.threadCount = threads;
+    pool.stopping = false;
+    pool.callerSense = 0;
+    pool.stats.assign(threads, BarrierStats());
+    resetBarrier(pool.barrier, threads);
+
+    int cpus = logicalCpuCount();
+    for (int t = 1; t < threads; t++) {
+        pool.workers.emplace_back(threadPoolWorker, &pool, t);
+        pinThread(pool.workers.back(), pinnedCpus.empty() ? t % cpus : pinnedCpus[t % pinnedCpus.size()]);
+    }
+}
+
+
+/**
+ * Wakes the workers of a pool with the stop flag set and joins them.
+ * 
+ * @param pool the pool, left with no threads
+*/
+void stopThreadPool(ThreadPool& pool)
+{
+    if (pool.threadCount == 0) {
+        return;
+    }
+    pool.stopping = true;
+    barrierWait(pool.barrier, pool.callerSense);
+    for (std::thread& worker : pool.workers) {
+        worker.join();
+    }
+    pool.workers.clear();
+    pool.threadCount = 0;
+}
+
+
+/**
+ * The loop of one pool worker: wait for a task, run it as its thread of the team, and meet the others at the end.
+ * 
+ * @param pool the pool
+ * @param threadId the worker's index in every team, from 1
+*/
+void threadPoolWorker(ThreadPool* pool, int threadId)
+{
+    int sense = 0;
+    for (;;) {
+        barrierWait(pool->barrier, sense);
+        if (pool->stopping) {
+            return;
+        }
+        PoolTeam team{threadId, pool->threadCount, pool, &sense};
+        (*pool->task)(team);
+        barrierWait(pool->barrier, sense);
+    }
+}
+
+
+/**
+ * @brief Runs a task on every thread of the shared pool, the calling thread included, and returns when all have finished.
+ * Starting and finishing a task each cost one barrier episode rather than creating threads.
+ * 
+ * @param task the task, called once per thread with that thread's team
+*/
+void runOnThreadPool(const std::function<void(PoolTeam&)>& task)
+{
+    ThreadPool& pool = sharedThreadPool();
+    pool.task = &task;
+    barrierWait(pool.barrier, pool.callerSense);
+    PoolTeam team{0, pool.threadCount, &pool, &pool.callerSense};
+    task(team);
+    barrierWait(pool.barrier, pool.callerSense);
+    backendUsed = {"threads", pool.threadCount};
+}
+
+
+/**
+ * Pins a thread to one logical CPU.
+ * 
+ * @param thread the thread
+ * @param cpu the logical CPU
+ * @return true if the thread was pinned; false where pinning is not supported
+*/
+bool pinThread(std::thread& thread, int cpu)
+{
+#ifdef ODD_EVEN_SORT_HAVE_AFFINITY
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) == 0;
+#else
+    (void)thread;
+    (void)cpu;
+    return false;
+#endif
+}
+
+
+/**
+ * Pins the calling thread to one logical CPU.
+ * 
+ * @param cpu the logical CPU
+ * @return true if the thread was pinned; false where pinning is not supported
+*/
+bool pinCurrentThread(int cpu)
+{
+#ifdef ODD_EVEN_SORT_HAVE_AFFINITY
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+
+/**
+ * @brief Pins thread t of the OpenMP team to pinnedCpus[t], if --pin chose a policy.
+ * OpenMP keeps its threads between parallel regions of the same size, so this is repeated whenever the
+ * thread count changes. Without OpenMP only the calling thread is pinned.
+*/
+void pinOpenMPThreads()
+{
+    if (pinnedCpus.empty()) {
+        return;
+    }
+    #pragma omp parallel default(none) shared(pinnedCpus)
+    {
+        OpenMPTeam team = openMPTeam();
+        pinCurrentThread(pinnedCpus[team.threadId % pinnedCpus.size()]);
+    }
+}
+
+
+/**
+ * Parses a sysfs CPU or node list such as 0-3,8,10-11.
+ * 
+ * @param text the list
+ * @return the numbers in the list
+*/
+std::vector<int> parseCpuList(const std::string& text)
+{
+    std::vector<int> numbers;
+    for (const std::string& range : splitList(text)) {
+        size_t dash = range.find('-');
+        int first = std::atoi(range.substr(0, dash).c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.substr(dash + 1).c_str());
+        for (int number = first; number <= last; number++) {
+            numbers.push_back(number);
+        }
+    }
+    return numbers;
+}
+
+
+/**
+ * @brief Reads the NUMA node, package and core of every logical CPU from sysfs.
+ * Where sysfs is missing, every CPU is its own core of package 0 on node 0.
+ * 
+ * @return the topology
+*/
+CpuTopology readCpuTopology()
+{
+    CpuTopology topology;
+    int cpus = logicalCpuCount();
+    topology.node.assign(cpus, 0);
+    topology.package.assign(cpus, 0);
+    topology.core.resize(cpus);
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        std::string directory = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        topology.core[cpu] = cpu;
+        std::ifstream(directory + "physical_package_id") >> topology.package[cpu];
+        std::ifstream(directory + "core_id") >> topology.core[cpu];
+    }
+
+    std::string nodes;
+    std::ifstream("/sys/devices/system/node/online") >> nodes;
+    for (int node : parseCpuList(nodes)) {
+        std::string cpuList;
+        std::ifstream("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist") >> cpuList;
+        for (int cpu : parseCpuList(cpuList)) {
+            if (cpu < cpus) {
+                topology.node[cpu] = node;
+            }
+        }
+        topology.nodeCount = std::max(topology.nodeCount, node + 1);
+    }
+    return topology;
+}
+
+
+/**
+ * @brief Returns the logical CPU of every thread index under a pinning policy.
+ * compact fills both SMT threads of a core before the next core, and one node before the next.
+ * scatter gives every thread a core of its own for as long as there are cores, dealing them to the
+ * nodes in turn, and only then uses the second SMT thread of each core.
+ * 
+ * @param topology the topology of the machine
+ * @param policy none, compact or scatter
+ * @return the CPU of thread t at index t, or nothing for none
+*/
+std::vector<int> pinningOrder(const CpuTopology& topology, const std::string& policy)
+{
+    if (policy != "compact" && policy != "scatter") {
+        return {};
+    }
+
+    int cpus = topology.node.size();
+    std::vector<int> order(cpus);
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        order[cpu] = cpu;
+    }
+    if (policy == "compact") {
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return std::make_tuple(topology.node[a], topology.package[a], topology.core[a]) <
+                   std::make_tuple(topology.node[b], topology.package[b], topology.core[b]);
+        });
+        return order;
+    }
+
+    // The SMT sibling index of every CPU within its core, and its rank among the CPUs of its node with that index
+    std::vector<int> sibling(cpus);
+    std::vector<int> rank(cpus);
+    std::map<std::pair<int, int>, int> siblingsSeen;
+    std::map<std::pair<int, int>, int> nodeSeen;
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        sibling[cpu] = siblingsSeen[{topology.package[cpu], topology.core[cpu]}]++;
+        rank[cpu] = nodeSeen[{topology.node[cpu], sibling[cpu]}]++;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return std::make_tuple(sibling[a], rank[a], topology.node[a]) < std::make_tuple(sibling[b], rank[b], topology.node[b]);
+    });
+    return order;
+}
+
+
+/**
+ * @brief Allocates an array whose pages are first touched by the threads that will work on them.
+ * Thread t of the selected backend's team, see runTeam(), writes the elements [n t / threads, n (t + 1) / threads),
+ * the contiguous slice the parallel engines give it, so with pinned OpenMP or pool threads each page lands on the
+ * NUMA node of the thread that later sorts it rather than on the node of the main thread.
+ * 
+ * @tparam T the element type
+ * @param n the number of elements
+ * @return the array, of value-initialised elements, to be released with delete[]
+*/
+template<typename T>
+T* firstTouchArray(long n)
+{
+    T* A = new T[n];
+    runTeam([&](auto& team) {
+        team.stage([&](long threadId, long threadCount) {
+            std::fill(A + n * threadId / threadCount, A + n * (threadId + 1) / threadCount, T());
+        });
+    });
+    return A;
+}
+
+
+/**
+ * @brief Prints on which NUMA nodes the pages of an array lie, if --pin chose a policy.
+ * Up to 4096 pages spread over the array are looked up with move_pages. A page is remote if it is not on the node
+ * of the thread whose static slice holds it, so its accesses by that thread cross the interconnect.
+ * 
+ * @param data the start of the array
+ * @param bytes the size of the array in bytes
+*/
+void printPagePlacement(const void* data, size_t bytes)
+{
+#ifdef ODD_EVEN_SORT_HAVE_AFFINITY
+    long pageSize = sysconf(_SC_PAGESIZE);
+    long pages = (bytes + pageSize - 1) / pageSize;
+    if (pinnedCpus.empty() || pages == 0) {
+        return;
+    }
+
+    long samples = std::min(pages, 4096L);
+    std::vector<void*> addresses(samples);
+    std::vector<int> status(samples, -1);
+    uintptr_t start = reinterpret_cast<uintptr_t>(data) & ~(uintptr_t)(pageSize - 1);
+    for (long sample = 0; sample < samples; sample++) {
+        addresses[sample] = reinterpret_cast<void*>(start + (uintptr_t)(sample * pages / samples) * pageSize);
+    }
+    if (syscall(SYS_move_pages, 0, samples, addresses.data(), nullptr, status.data(), 0) != 0) {
+        cout << "Page placement unavailable: " << std::strerror(errno) << endl;
+        return;
+    }
+
+    int threads = backendThreadCount();
+    std::vector<long> onNode(cpuTopology.nodeCount);
+    long remote = 0;
+    for (long sample = 0; sample < samples; sample++) {
+        if (status[sample] < 0 || status[sample] >= cpuTopology.nodeCount) {
+            continue;
+        }
+        onNode[status[sample]]++;
+        long owner = (sample * pages / samples) * threads / pages;
+        remote += status[sample] != cpuTopology.node[pinnedCpus[owner % pinnedCpus.size()]];
+    }
+    cout << "Pages by NUMA node:";
+    for (int node = 0; node < cpuTopology.nodeCount; node++) {
+        cout << (node > 0 ? "," : "") << " node " << node << " " << 100.0 * onNode[node] / samples << "%";
+    }
+    cout << "; " << 100.0 * remote / samples << "% remote from the thread that sorts them" << endl;
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
+
+
+/**
+ * Returns the length of each STREAM array: four times the last-level cache, at least 32 MiB and at most 512 MiB of doubles.
+ * 
+ * @return the number of doubles in each array
+*/
+long streamArrayLength()
+{
+    long cacheBytes = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    cacheBytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    return std::min(std::max(4 * cacheBytes / (long)sizeof(double), 1L << 22), 1L << 26);
+}
+
+
+/**
+ * @brief Measures the STREAM triad bandwidth of one set of CPUs over memory first touched by another.
+ * One OpenMP thread per CPU pins itself and works on its static slice, so with both sets on one node the result
+ * is the local bandwidth of that node, and with the sets on different nodes it is the remote bandwidth between them.
+ * The best of five trials is returned. The OpenMP threads are left pinned to computeCpus.
+ * 
+ * @param computeCpus the CPUs that run the triad
+ * @param memoryCpus the CPUs that first touch the arrays
+ * @return the bandwidth in bytes per second, counting 24 bytes per element
+*/
+long double triadBandwidth(const std::vector<int>& computeCpus, const std::vector<int>& memoryCpus)
+{
+    long n = streamArrayLength();
+    double* a = new double[n];
+    double* b = new double[n];
+    double* c = new double[n];
+    const double scalar = 3.0;
+
+    #pragma omp parallel num_threads((int)memoryCpus.size()) default(none) shared(a, b, c, n, memoryCpus)
+    {
+        OpenMPTeam team = openMPTeam();
+        pinCurrentThread(memoryCpus[team.threadId % memoryCpus.size()]);
+        for (long i = n * team.threadId / team.threadCount; i < n * (team.threadId + 1) / team.threadCount; i++) {
+            a[i] = 1.0;
+            b[i] = 2.0;
+            c[i] = 0.0;
+        }
+    }
+
+    long double best = 0;
+    #pragma omp parallel num_threads((int)computeCpus.size()) default(none) shared(a, b, c, n, scalar, computeCpus, best)
+    {
+        OpenMPTeam team = openMPTeam();
+        pinCurrentThread(computeCpus[team.threadId % computeCpus.size()]);
+        long begin = n * team.threadId / team.threadCount;
+        long end = n * (team.threadId + 1) / team.threadCount;
+        for (int trial = 0; trial < 5; trial++) {
+            team.barrier();
+            auto start = std::chrono::steady_clock::now();
+            for (long i = begin; i < end; i++) {
+                a[i] = b[i] + scalar * c[i];
+            }
+            team.barrier();
+            if (team.threadId == 0) {
+                auto finish = std::chrono::steady_clock::now();
+                best = std::max(best, 3.0L * sizeof(double) * n / std::chrono::duration<long double>(finish - start).count());
+            }
+        }
+    }
+
+    // Keep the results live so the kernel is not optimised away
+    volatile double sink = a[n / 2];
+    (void)sink;
+
+    delete[] a;
+    delete[] b;
+    delete[] c;
+    return best;
+}
+
+
+/**
+ * @brief Prints the triad bandwidth from the CPUs of every NUMA node to the memory of every node.
+ * The diagonal is each node's local bandwidth; the rest shows what a thread pays for pages on the wrong node.
+ * The OpenMP threads are pinned again with pinOpenMPThreads() afterwards.
+ * 
+ * @param topology the topology of the machine
+*/
+void printNodeBandwidth(const CpuTopology& topology)
+{
+    std::vector<std::vector<int>> nodeCpus(topology.nodeCount);
+    for (size_t cpu = 0; cpu < topology.node.size(); cpu++) {
+        nodeCpus[topology.node[cpu]].push_back(cpu);
+    }
+
+    cout << "Triad bandwidth in GB/s, threads on the row node, memory on the column node:" << endl;
+    for (int from = 0; from < topology.nodeCount; from++) {
+        if (nodeCpus[from].empty()) {
+            continue;
+        }
+        cout << "  node " << from << ":";
+        for (int to = 0; to < topology.nodeCount; to++) {
+            if (!nodeCpus[to].empty()) {
+                cout << " " << triadBandwidth(nodeCpus[from], nodeCpus[to]) / 1e9L;
+            }
+        }
+        cout << endl;
+    }
+    pinOpenMPThreads();
+}
+
+
+/**
+ * Clears the barrier statistics of the thread pool, without starting it.
+*/
+void resetBarrierStats()
+{
+    threadPool.stats.assign(threadPool.threadCount, BarrierStats());
+}
+
+
+/**
+ * Prints the stage barriers of the last thread pool task and the mean time a thread waited at each.
+ * Prints nothing unless timeBarriers was set.
+*/
+void printBarrierStats()
+{
+    const ThreadPool& pool = threadPool;
+    long long barriers = 0;
+    long double waitSeconds = 0;
+    long double slowest = 0;
+    for (const BarrierStats& stats : pool.stats) {
+        barriers += stats.barriers;
+        waitSeconds += stats.waitSeconds;
+        slowest = std::max(slowest, stats.waitSeconds);
+    }
+    if (barriers == 0) {
+        return;
+    }
+    cout << "Barriers: " << barriers / pool.threadCount << " stages on " << pool.threadCount << " threads, mean wait "
+         << 1e6L * waitSeconds / barriers << " microseconds per thread per stage, "
+         << slowest << " seconds for the thread that waited longest" << endl;
+}
+
+/**
+ * Checks at runtime whether the CPU supports AVX2.
+ * 
+ * @return true if the AVX2 kernels can be used on this machine
+*/
+bool cpuHasAVX2()
+{
+#ifdef ODD_EVEN_SORT_HAVE_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * Compare-exchanges two contiguous runs element by element,
+ * so that hi[i] is not ordered before lo[i] afterwards. The runs must not overlap.
+ * 
+ * @param lo the run holding the elements that come first afterwards
+ * @param hi the run holding the elements that come last afterwards
+ * @param len the number of elements in each run
+ * @param comp the ordering of the keys
+*/
+template<typename T, typename Compare>
+void compareExchangeRun(T lo[], T hi[], long len, Compare comp)
+{
+    for(long i = len; i--;)
+        if(comp(hi[i], lo[i]))
+            std::swap(lo[i], hi[i]);
+}
+
+
+/**
+ * @brief Compare-exchanges two contiguous runs using 8-lane AVX2 min/max.
+ * Elements left over after the last full vector are handled by the scalar kernel.
+ * Must only be called when cpuHasAVX2() returns true.
+ * 
+ * @param lo the run holding the smaller elements afterwards
+ * @param hi the run holding the larger elements afterwards
+ * @param len the number of elements in each run
+*/
+#ifdef ODD_EVEN_SORT_HAVE_AVX2
+__attribute__((target("avx2")))
+void compareExchangeRunAVX2(int lo[], int hi[], int len)
+{
+    int i = 0;
+    for(; i + 8 <= len; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lo + i), _mm256_min_epi32(a, b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hi + i), _mm256_max_epi32(a, b));
+    }
+    compareExchangeRun(lo + i, hi + i, len - i, std::less<int>());
+}
+#else
+void compareExchangeRunAVX2(int lo[], int hi[], int len)
+{
+    compareExchangeRun(lo, hi, len, std::less<int>());
+}
+#endif
+
+
+/**
+ * @brief Compare-exchanges two contiguous runs with the fastest kernel available for the key type and ordering.
+ * int keys in ascending or descending order use the AVX2 kernel for runs of at least one full vector;
+ * every other key type and ordering uses the scalar kernel, with the comparator inlined.
+ * 
+ * @param lo the run holding the elements that come first afterwards
+ * @param hi the run holding the elements that come last afterwards
+ * @param len the number of elements in each run
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 kernel may be used
+*/
+template<typename T, typename Compare>
+void compareExchangeRunVector(T lo[], T hi[], long len, Compare comp, bool useAVX2)
+{
+    if constexpr (std::is_same<T, int>::value && std::is_same<Compare, std::less<int>>::value)
+    {
+        if(useAVX2 && len >= 8)
+            return compareExchangeRunAVX2(lo, hi, len);
+    }
+    if constexpr (std::is_same<T, int>::value && std::is_same<Compare, std::greater<int>>::value)
+    {
+        if(useAVX2 && len >= 8)
+            return compareExchangeRunAVX2(hi, lo, len);
+    }
+    compareExchangeRun(lo, hi, len, comp);
+}
+
+
+/**
+ * @brief Sorts an array using Listing 4 with a vectorised inner loop.
+ * The innermost loop compares two contiguous runs A[j..j+len) and A[j+k..j+k+len),
+ * so it is handed to the AVX2 kernel whenever the run holds at least one full vector.
+ * Falls back to the scalar kernel when the CPU does not support AVX2.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4AVX2(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+
+    for(int p = 1; p < n; p *= 2)
+        for(int k = p; k > 0; k /= 2)
+            for(int j = k & (p - 1); j + k < n; j += 2*k)
+                if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
+                    compareExchangeRunVector(A + j, A + j + k, std::min(k, n-j-k), comp, useAVX2);
+
+    return A;
+}
+
+
+/**
+ * @brief Sorts every full 16-element block of an array in SIMD registers.
+ * A block is held in two 8-lane AVX2 registers and runs all stages of Listing 4 with p <= 8,
+ * i.e. every stage whose comparators stay inside an aligned 16-element window.
+ * Each stage permutes the partner of every lane into place, takes min/max and blends
+ * the results back, so the block is loaded and stored once instead of once per stage.
+ * A trailing partial block is left untouched. Must only be called when cpuHasAVX2() returns true.
+ * 
+ * @param A the array whose blocks are sorted
+ * @param n the size of the array
+ * @param descending whether to sort in descending order, i.e. by std::greater<int>
+*/
+#ifdef ODD_EVEN_SORT_HAVE_AVX2
+__attribute__((target("avx2")))
+void sortBlocks16AVX2(int A[], int n, bool descending)
+{
+    // Per stage and register: partner lane, partner register and whether the lane keeps the maximum
+    struct Stage { alignas(32) int idx[2][8]; alignas(32) int fromHi[2][8]; alignas(32) int upper[2][8]; };
+    static const std::vector<Stage> stages = [] {
+        std::vector<Stage> result;
+        for(int p = 1; p < 16; p *= 2)
+            for(int k = p; k > 0; k /= 2)
+            {
+                int partner[16], upper[16];
+                for(int l = 0; l < 16; l++)
+                {
+                    partner[l] = l;
+                    upper[l] = 0;
+                }
+                for(int j = k & (p - 1); j + k < 16; j += 2*k)
+                    if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
+                        for(int i = std::min(k, 16-j-k); i--;)
+                        {
+                            partner[j+i] = j+i+k;
+                            partner[j+i+k] = j+i;
+                            upper[j+i+k] = -1;
+                        }
+
+                Stage stage;
+                for(int l = 0; l < 16; l++)
+                {
+                    stage.idx[l / 8][l % 8] = partner[l] % 8;
+                    stage.fromHi[l / 8][l % 8] = partner[l] >= 8 ? -1 : 0;
+                    stage.upper[l / 8][l % 8] = upper[l];
+                }
+                result.push_back(stage);
+            }
+        return result;
+    }();
+
+    for(int b = 0; b + 16 <= n; b += 16)
+    {
+        __m256i v[2];
+        v[0] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(A + b));
+        v[1] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(A + b + 8));
+
+        for(const Stage& stage : stages)
+        {
+            __m256i next[2];
+            for(int r = 0; r < 2; r++)
+            {
+                __m256i idx = _mm256_load_si256(reinterpret_cast<const __m256i*>(stage.idx[r]));
+                __m256i fromHi = _mm256_load_si256(reinterpret_cast<const __m256i*>(stage.fromHi[r]));
+                __m256i upper = _mm256_load_si256(reinterpret_cast<const __m256i*>(stage.upper[r]));
+                __m256i partner = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(v[0], idx),
+                                                     _mm256_permutevar8x32_epi32(v[1], idx), fromHi);
+                __m256i low = _mm256_min_epi32(v[r], partner);
+                __m256i high = _mm256_max_epi32(v[r], partner);
+                next[r] = descending ? _mm256_blendv_epi8(high, low, upper) : _mm256_blendv_epi8(low, high, upper);
+            }
+            v[0] = next[0];
+            v[1] = next[1];
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(A + b), v[0]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(A + b + 8), v[1]);
+    }
+}
+#else
+void sortBlocks16AVX2(int A[], int n, bool descending)
+{
+    for(int b = 0; b + 16 <= n; b += 16)
+        if(descending)
+            sortListing4<int, std::greater<int>>(A + b, 16);
+        else
+            sortListing4<int>(A + b, 16);
+}
+#endif
+
+
+/**
+ * Applies one (p,k) stage of Listing 4 in a full sweep over the array and counts it as one pass.
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param p the current round of Listing 4
+ * @param k the level within the round
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+*/
+template<typename T, typename Compare>
+void applyLevel(T A[], int n, int p, int k, Compare comp, bool useAVX2)
+{
+    for(int j = k & (p - 1); j + k < n; j += 2*k)
+        if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
+            compareExchangeRunVector(A + j, A + j + k, std::min(k, n-j-k), comp, useAVX2);
+    passCount++;
+}
+
+
+/**
+ * @brief Applies the merge levels k = kTop, kTop/2, ..., 1 of one Listing 4 round p in a single sweep.
+ * Below k = p the comparators of a level are no longer confined to aligned windows:
+ * each level pairs the odd k-blocks with the following even k-block, so groups straddle
+ * window boundaries and the levels cannot be split into independent tiles.
+ * Instead every level trails the one above it by a fixed lag of 4k elements, which is
+ * enough for all of an element's higher-level comparators to have run before it is touched.
+ * The active window is a few kTop wide, so the array is streamed through the cache once.
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param p the current round of Listing 4
+ * @param kTop the first level to apply; must be a power of two smaller than p
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+*/
+template<typename T, typename Compare>
+void applyFusedLevels(T A[], int n, int p, int kTop, Compare comp, bool useAVX2)
+{
+    std::vector<long> next, lag;
+    for(int k = kTop; k > 0; k /= 2)
+    {
+        next.push_back(k);
+        lag.push_back(lag.empty() ? 0 : lag.back() + 4*k);
+    }
+
+    for(long frontier = 2*kTop; ; frontier += 2*kTop)
+    {
+        bool done = true;
+        int level = 0;
+        for(int k = kTop; k > 0; k /= 2, level++)
+        {
+            long j = next[level];
+            for(; j + k < n && j + 2*k <= frontier - lag[level]; j += 2*k)
+                if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
+                    compareExchangeRunVector(A + j, A + j + k, std::min<long>(k, n-j-k), comp, useAVX2);
+            next[level] = j;
+            if(j + k < n)
+                done = false;
+        }
+        if(done)
+            break;
+    }
+    passCount++;
+}
+
+
+/**
+ * @brief Sorts an array using Listing 4 with a register-resident network for the small-k stages.
+ * The first four rounds (p = 1, 2, 4, 8) only compare inside aligned 16-element windows,
+ * so each 16-element block is sorted in SIMD registers before moving to the next one.
+ * Only int keys in either order have a register network; other keys sort their blocks with scalar Listing 4.
+ * For the later rounds the levels k >= 16 sweep the array as in Listing 4 and the
+ * levels k = 8, 4, 2, 1 are fused into a single sweep by applyFusedLevels().
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4Network16(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+
+    int blocked = n - n % 16;
+    int inRegisters = 0;
+    if constexpr (std::is_same<T, int>::value &&
+                  (std::is_same<Compare, std::less<int>>::value || std::is_same<Compare, std::greater<int>>::value))
+    {
+        if(useAVX2)
+        {
+            sortBlocks16AVX2(A, blocked, std::is_same<Compare, std::greater<int>>::value);
+            inRegisters = blocked;
+        }
+    }
+    for(int b = inRegisters; b < blocked; b += 16)
+        sortListing4<T, Compare>(A + b, 16);
+    sortListing4<T, Compare>(A + blocked, n - blocked);
+    passCount = 1;
+
+    for(int p = 16; p < n; p *= 2)
+    {
+        for(int k = p; k >= 16; k /= 2)
+            applyLevel(A, n, p, k, comp, useAVX2);
+        applyFusedLevels(A, n, p, 8, comp, useAVX2);
+    }
+
+    return A;
+}
+
+
+/**
+ * @brief Picks the number of elements in one cache tile for the blocked engine.
+ * Uses half of the L2 cache when the system reports its size, 256 KiB otherwise,
+ * rounded down to a power of two so that tiles line up with the 2p-blocks of Listing 4.
+ * 
+ * @param elementSize the size of one key in bytes
+ * @return the tile size in elements
+*/
+int cacheTileSize(size_t elementSize)
+{
+    long bytes = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    if(bytes <= 0)
+        bytes = 256 * 1024;
+
+    int tile = 16;
+    while(2L * tile * (long)elementSize <= bytes / 2)
+        tile *= 2;
+    return tile;
+}
+
+
+/**
+ * @brief Sorts an array using Listing 4 with cache-blocked stage fusion.
+ * Every round p < tile only compares inside aligned tiles, so each tile is fully sorted
+ * while it sits in L2, which takes one pass over the array instead of one per (p,k) stage.
+ * In the later rounds the levels k > tile / 8 sweep the array as in Listing 4 and the
+ * remaining levels are fused into a single sweep by applyFusedLevels(), whose window
+ * of about 6 * kTop elements still fits in the tile.
+ * The number of passes made is left in passCount.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4Blocked(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    static const int tile = cacheTileSize(sizeof(T));
+
+    for(long t = 0; t < n; t += tile)
+        sortListing4AVX2<T, Compare>(A + t, std::min<long>(tile, n - t));
+    passCount = 1;
+
+    for(int p = tile; p < n; p *= 2)
+    {
+        int kTop = std::min(p / 2, tile / 8);
+        for(int k = p; k > kTop; k /= 2)
+            applyLevel(A, n, p, k, comp, useAVX2);
+        applyFusedLevels(A, n, p, kTop, comp, useAVX2);
+    }
+
+    return A;
+}
+
+
+/**
+ * @brief Sorts an array with Batcher's recursion as OpenMP tasks instead of the loop nest of Listing 4.
+ * The array is padded in thought to a power of two; every block sorts its two halves as independent tasks
+ * and then merges them with the rounds p = size / 2 of Listing 4 restricted to the block, so a subtree
+ * only ever waits for its own children, never on a barrier across the whole array.
+ * Blocks of one cache tile (see cacheTileSize()) are sorted with sortListing4AVX2 by the task that reaches them.
+ * Idle threads steal tasks from the OpenMP runtime's task queues.
+ * Built without OpenMP, the same tiles and rounds run stage by stage on runTeam()'s backend, see listing4TiledStages().
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4ParallelTasks(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    static const int tile = cacheTileSize(sizeof(T));
+    bool vectorised = useAVX2;
+    int cutoff = tile;
+
+#ifdef _OPENMP
+    noteOpenMPBackend();
+    long size = 1;
+    while(size < n)
+        size *= 2;
+
+    #pragma omp parallel default(none) shared(A, n, size, comp, vectorised, cutoff)
+    {
+        #pragma omp single
+        oddEvenMergeSortTask(A, n, 0, size, comp, vectorised, cutoff);
+    }
+#else
+    runTeam([&](auto& team) { listing4TiledStages(A, n, cutoff, comp, vectorised, team); });
+#endif
+
+    return A;
+}
+
+
+/**
+ * Sorts the tiles of the array and then applies the rounds p >= tile of Listing 4 as one thread of a team:
+ * the same network as the task recursion of sortListing4ParallelTasks, but with a barrier after every stage.
+ * Each thread sorts a contiguous run of whole tiles, and every stage is split as in listing4Stages().
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param tile the length of the blocks sorted serially, a power of two
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+ * @param team the calling thread's index, the team size and the barrier
+*/
+template<typename T, typename Compare, typename Team>
+void listing4TiledStages(T A[], int n, int tile, Compare comp, bool useAVX2, Team& team)
+{
+    team.stage([&](long threadId, long threadCount) {
+        long tiles = (n + tile - 1) / tile;
+        for(long t = tiles * threadId / threadCount; t < tiles * (threadId + 1) / threadCount; t++)
+            sortListing4AVX2<T, Compare>(A + t * tile, std::min<long>(tile, n - t * tile));
+    });
+
+    for(int p = tile; p < n; p *= 2)
+    {
+        for(int k = p; k > 0; k /= 2)
+        {
+            team.stage([&](long threadId, long threadCount) {
+                applyLevelSlice(A, n, p, k, comp, useAVX2, threadId, threadCount);
+            });
+        }
+    }
+}
+
+
+/**
+ * Sorts one aligned power-of-two block of the padded array: its halves as a child task and in the calling task,
+ * then their merge once both are sorted. Parts of the block at or past n are padding and are never touched.
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param lo the start of the block, a multiple of size
+ * @param size the length of the block, a power of two
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+ * @param cutoff the block length sorted serially, a power of two
+*/
+template<typename T, typename Compare>
+void oddEvenMergeSortTask(T A[], int n, long lo, long size, Compare comp, bool useAVX2, int cutoff)
+{
+    if(lo >= n)
+        return;
+    if(size <= cutoff)
+    {
+        sortListing4AVX2<T, Compare>(A + lo, std::min<long>(size, n - lo));
+        return;
+    }
+
+    long half = size / 2;
+    #pragma omp task default(none) firstprivate(A, n, lo, half, comp, useAVX2, cutoff)
+    oddEvenMergeSortTask(A, n, lo, half, comp, useAVX2, cutoff);
+    oddEvenMergeSortTask(A, n, lo + half, half, comp, useAVX2, cutoff);
+    #pragma omp taskwait
+
+    // With the upper half all padding, the block is already sorted
+    if(lo + half < n)
+        oddEvenMergeTask(A + lo, std::min<long>(size, n - lo), half, comp, useAVX2, cutoff);
+}
+
+
+/**
+ * @brief Merges the two sorted halves of a block with the stages (p,k), k = p, p/2, ..., 1, of Listing 4.
+ * Every stage is split into one task per cutoff elements, and the tasks of a stage are awaited before the next.
+ * 
+ * @param A the start of the block
+ * @param m the length of the block that lies inside the array, at most 2p
+ * @param p the length of each sorted half
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+ * @param cutoff the number of elements one task covers
+*/
+template<typename T, typename Compare>
+void oddEvenMergeTask(T A[], int m, int p, Compare comp, bool useAVX2, int cutoff)
+{
+    long slices = (m + cutoff - 1) / cutoff;
+    for(int k = p; k > 0; k /= 2)
+    {
+        for(long s = 1; s < slices; s++)
+        {
+            #pragma omp task default(none) firstprivate(A, m, p, k, comp, useAVX2, s, slices)
+            applyLevelSlice(A, m, p, k, comp, useAVX2, s, slices);
+        }
+        applyLevelSlice(A, m, p, k, comp, useAVX2, 0, slices);
+        #pragma omp taskwait
+    }
+}
+
+
+/**
+ * @brief Sorts an array using Listing 4, choosing for every (p,k) stage whether to run it serially, with SIMD or on every thread.
+ * planStages() prices each stage with the calibrated stageCosts: a threaded stage saves its work divided over the
+ * threads but pays a barrier, so the small stages of small arrays, or those whose j-ranges the (j | (2p - 1)) test
+ * mostly rejects, stay on one thread. Consecutive single-thread stages share one barrier, and no parallel region
+ * is opened at all when no stage is threaded. The plan is left in stagePlan for the trace.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T, typename Compare>
+T* sortListing4ParallelAdaptive(T A[], int n)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    bool vectorised = useAVX2;
+
+    // Only int keys in either order have an AVX2 kernel, see compareExchangeRunVector()
+    bool simd = useAVX2 && std::is_same<T, int>::value &&
+                (std::is_same<Compare, std::less<int>>::value || std::is_same<Compare, std::greater<int>>::value);
+    stagePlan = planStages(n, backendThreadCount(), simd);
+    const std::vector<StageDecision>& plan = stagePlan;
+
+    auto uses = [&](StageMode mode) {
+        return std::any_of(plan.begin(), plan.end(), [&](const StageDecision& stage) { return stage.mode == mode; });
+    };
+    if(!uses(StageMode::Threaded))
+    {
+        OpenMPTeam team;
+        listing4AdaptiveStages(A, n, comp, vectorised, plan, team);
+        backendUsed = {uses(StageMode::Simd) ? "simd" : "serial", 1};
+        return A;
+    }
+
+    runTeam([&](auto& team) { listing4AdaptiveStages(A, n, comp, vectorised, plan, team); });
+
+    return A;
+}
+
+
+/**
+ * Applies the stages of Listing 4 as one thread of a team, following a stage plan. Threaded stages are sliced
+ * over the team with team.stage(); each run of single-thread stages is applied by thread 0 in one team.single().
+ * 
+ * @param A the array being sorted
+ * @param n the size of the array
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 compare-exchange kernel may be used
+ * @param plan the execution of every stage, in the order of Listing 4
+ * @param team the calling thread's index, the team size and the barrier
+*/
+template<typename T, typename Compare, typename Team>
+void listing4AdaptiveStages(T A[], int n, Compare comp, bool useAVX2, const std::vector<StageDecision>& plan, Team& team)
+{
+    size_t stage = 0;
+    while(stage < plan.size())
+    {
+        const StageDecision& decision = plan[stage];
+        if(decision.mode == StageMode::Threaded)
+        {
+            team.stage([&](long threadId, long threadCount) {
+                applyLevelSlice(A, n, decision.p, decision.k, comp, useAVX2, threadId, threadCount);
+            });
+            stage++;
+            continue;
+        }
+
+        size_t end = stage;
+        while(end < plan.size() && plan[end].mode != StageMode::Threaded)
+            end++;
+        team.single([&]() {
+            for(size_t s = stage; s < end; s++)
+                applyLevelSlice(A, n, plan[s].p, plan[s].k, comp, useAVX2 && plan[s].mode == StageMode::Simd, 0, 1);
+        });
+        stage = end;
+    }
+}
+
+
+/**
+ * @brief Chooses the cheapest execution of every (p,k) stage of Listing 4 under stageCosts.
+ * One thread costs comparators times the scalar or, for runs of at least 8 keys, the SIMD cost per comparator.
+ * Every thread costs that divided by the thread count, plus one barrier.
+ * 
+ * @param n the size of the array
+ * @param threads the number of threads available
+ * @param simd whether the key type and ordering have an AVX2 kernel
+ * @return the execution of every stage, in the order of Listing 4
+*/
+std::vector<StageDecision> planStages(int n, int threads, bool simd)
+{
+    std::vector<StageDecision> plan;
+    double barrier = threads > 1 ? stageBarrierNs(threads) : 0;
+    for(int p = 1; p < n; p *= 2)
+    {
+        for(int k = p; k > 0; k /= 2)
+        {
+            long comparators = stageComparators(n, p, k);
+            bool vector = simd && k >= 8;
+            double single = comparators * (vector ? stageCosts.simdNs : stageCosts.scalarNs);
+            double shared = single / threads + barrier;
+            if(threads > 1 && shared < single)
+                plan.push_back({p, k, comparators, StageMode::Threaded, shared});
+            else
+                plan.push_back({p, k, comparators, vector ? StageMode::Simd : StageMode::Serial, single});
+        }
+    }
+    return plan;
+}
+
+
+/**
+ * Names a stage mode for the trace.
+ * 
+ * @param mode the mode
+ * @return "serial", "simd" or "threaded"
+*/
+const char* stageModeName(StageMode mode)
+{
+    switch (mode) {
+    case StageMode::Serial:
+        return "serial";
+    case StageMode::Simd:
+        return "simd";
+    case StageMode::Threaded:
+        return "threaded";
+    }
+    return "unknown";
+}
+
+
+/**
+ * @brief Counts the comparators of one (p,k) stage of Listing 4 that lie inside the array.
+ * Every whole block of 2p keys has p of them for k = p and p - k otherwise: the groups j = k, 3k, ..., 2p - 3k
+ * of k comparators each. The block cut short by n keeps the groups, or parts of groups, below n.
+ * 
+ * @param n the size of the array
+ * @param p the round
+ * @param k the level within the round
+ * @return the number of compare-exchanges the stage makes
+*/
+long stageComparators(int n, int p, int k)
+{
+    long blocks = n / (2L * p);
+    long rest = n % (2L * p);
+    if(k == p)
+        return blocks * p + std::max(0L, rest - p);
+
+    long groups = p / k - 1;
+    long whole = rest >= k ? std::min(groups, (rest - k) / (2L * k)) : 0;
+    long partial = whole < groups ? std::min<long>(k, std::max(0L, rest - 2L * k * (whole + 1))) : 0;
+    return blocks * (p - k) + whole * k + partial;
+}
+
+
+/**
+ * @brief Measures the costs of the stage cost model once, and the barrier for every thread count given.
+ * The kernels compare-exchange two runs of 4096 random int keys, fresh for every one of 64 timed trials,
+ * and keep the fastest trial per comparator. A barrier is the median of 5 trials of 1000 empty stages each on the
+ * selected backend, all measured here, before any timed sort, so that planStages() never measures inside one.
+ * 
+ * @param threadCounts the thread counts the adaptive engine may run with
+*/
+void calibrateStageCosts(const std::vector<int>& threadCounts)
+{
+    const int len = 4096;
+    std::vector<int> source(2 * len);
+    std::vector<int> work(2 * len);
+    std::mt19937 generator(12345);
+    for (int& key : source) {
+        key = generator();
+    }
+
+    auto fastest = [&](bool useAVX2) {
+        long double best = std::numeric_limits<long double>::max();
+        for (int trial = 0; trial < 64; trial++) {
+            std::copy(source.begin(), source.end(), work.begin());
+            auto start = std::chrono::steady_clock::now();
+            compareExchangeRunVector(work.data(), work.data() + len, len, std::less<int>(), useAVX2);
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<long double, std::nano>(end - start).count() / len);
+        }
+        volatile int sink = work[len / 2];
+        (void)sink;
+        return (double)best;
+    };
+    stageCosts.scalarNs = fastest(false);
+    stageCosts.simdNs = cpuHasAVX2() ? fastest(true) : stageCosts.scalarNs;
+
+    cout << "Stage cost model: " << stageCosts.scalarNs << " ns per scalar comparator, " << stageCosts.simdNs << " ns per SIMD comparator";
+    std::set<int> counts(threadCounts.begin(), threadCounts.end());
+    for (int threads : counts) {
+        if (threads > 1) {
+            stageCosts.barrierNs[{parallelBackend, threads}] = measureStageBarrierNs(threads);
+            cout << ", " << stageBarrierNs(threads) / 1e3 << " us per barrier of " << threads << " threads";
+        }
+    }
+    cout << endl;
+}
+
+
+/**
+ * @brief Returns the cost of one empty stage on the selected backend, as calibrated by calibrateStageCosts().
+ * A team size that was not calibrated takes the cost of the nearest one that was; with none calibrated the
+ * cost is infinite, so that planStages() keeps every stage on one thread rather than measuring inside a timed sort.
+ * 
+ * @param threads the team size
+ * @return the time of one stage in nanoseconds
+*/
+double stageBarrierNs(int threads)
+{
+    double nanoseconds = std::numeric_limits<double>::infinity();
+    int distance = std::numeric_limits<int>::max();
+    for (const auto& known : stageCosts.barrierNs) {
+        if (known.first.first == parallelBackend && std::abs(known.first.second - threads) < distance) {
+            distance = std::abs(known.first.second - threads);
+            nanoseconds = known.second;
+        }
+    }
+    return nanoseconds;
+}
+
+
+/**
+ * @brief Measures the cost of one empty stage on the selected backend: the median of 5 trials of 1000 stages each.
+ * The stage is the barrier of OpenMP or the thread pool, or the fork and join of one std::execution algorithm.
+ * 
+ * @param threads the team size
+ * @return the median time of one stage in nanoseconds
+*/
+double measureStageBarrierNs(int threads)
+{
+    // Run one team of the given size, then put the thread counts and the last backend back
+    int savedRequested = requestedThreads;
+    BackendRun savedRun = backendUsed;
+    requestedThreads = threads;
+#ifdef _OPENMP
+    int savedThreads = omp_get_max_threads();
+    omp_set_num_threads(threads);
+#endif
+
+    const int trials = 5;
+    const int stages = 1000;
+    std::vector<long double> samples(trials);
+    runTeam([&](auto& team) {
+        team.stage([](long, long) {});
+        for (int trial = 0; trial < trials; trial++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int stage = 0; stage < stages; stage++) {
+                team.stage([](long, long) {});
+            }
+            if (team.threadId == 0) {
+                samples[trial] = std::chrono::duration<long double, std::nano>(std::chrono::steady_clock::now() - start).count() / stages;
+            }
+        }
+    });
+
+    requestedThreads = savedRequested;
+    backendUsed = savedRun;
+#ifdef _OPENMP
+    omp_set_num_threads(savedThreads);
+#endif
+    pinOpenMPThreads();
+    resetBarrierStats();
+    std::sort(samples.begin(), samples.end());
+    return quantile(samples, 0.5);
+}
+
+
+/**
+ * Prints how many stages of the last adaptive sort ran serially, with SIMD and threaded, and with everyStage
+ * the decision, comparators and estimated time of each (p,k) stage.
+ * 
+ * @param everyStage whether to print every stage, as --trace-stages asks
+*/
+void printStagePlan(bool everyStage)
+{
+    if (stagePlan.empty()) {
+        return;
+    }
+    std::map<StageMode, int> modes;
+    for (const StageDecision& stage : stagePlan) {
+        modes[stage.mode]++;
+        if (everyStage) {
+            cout << "  p = " << stage.p << ", k = " << stage.k << ": " << stageModeName(stage.mode) << ", "
+                 << stage.comparators << " comparators, " << stage.estimatedNs << " ns estimated" << endl;
+        }
+    }
+    cout << "Stages: " << modes[StageMode::Serial] << " serial, " << modes[StageMode::Simd] << " simd, "
+         << modes[StageMode::Threaded] << " threaded" << endl;
+}
+
+
+/**
+ * Sorts an array with std::sort, the baseline the listings are measured against.
+ * 
+ * @tparam T the key type
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T>
+T* sortStd(T A[], int n)
+{
+    std::sort(A, A + n);
+    return A;
+}
+
+
+/**
+ * Sorts an array with std::stable_sort.
+ * 
+ * @tparam T the key type
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T>
+T* sortStdStable(T A[], int n)
+{
+    std::stable_sort(A, A + n);
+    return A;
+}
+
+
+/**
+ * @brief Sorts an array with std::sort under the parallel unsequenced execution policy.
+ * Only registered when built with ODD_EVEN_SORT_PARALLEL_STL and the library provides std::execution;
+ * otherwise it is std::sort.
+ * 
+ * @tparam T the key type
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T>
+T* sortStdParUnseq(T A[], int n)
+{
+#if defined(ODD_EVEN_SORT_PARALLEL_STL) && defined(__cpp_lib_execution)
+    std::sort(std::execution::par_unseq, A, A + n);
+    backendUsed = {"std", (int)std::thread::hardware_concurrency()};
+#else
+    std::sort(A, A + n);
+#endif
+    return A;
+}
+
+
+/**
+ * @brief Maps a key to unsigned bits whose unsigned order is the ascending order of the keys.
+ * Signed integers have their sign bit flipped. Floating-point keys have their sign bit flipped if positive,
+ * and every bit flipped if negative.
+ * 
+ * @tparam T the key type: a 32 or 64-bit integer or floating-point type
+ * @param key the key
+ * @return the bits to sort by
+*/
+template<typename T>
+typename std::conditional<sizeof(T) == 8, uint64_t, uint32_t>::type radixKey(T key)
+{
+    using Bits = typename std::conditional<sizeof(T) == 8, uint64_t, uint32_t>::type;
+    static_assert(sizeof(T) == sizeof(Bits), "radix keys are 32 or 64 bits");
+    const Bits sign = Bits(1) << (8 * sizeof(Bits) - 1);
+
+    Bits bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    if (std::is_floating_point<T>::value) {
+        return (bits & sign) ? ~bits : bits | sign;
+    }
+    return std::is_signed<T>::value ? bits ^ sign : bits;
+}
+
+
+/**
+ * @brief Sorts an array with a least-significant-digit radix sort over bytes.
+ * Each byte takes one counting pass and one stable scatter between A and a buffer. Bytes on which
+ * every key agrees, such as the high bytes of small keys, are skipped.
+ * 
+ * @tparam T the key type
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T>
+T* sortRadixLSD(T A[], int n)
+{
+    std::vector<T> buffer(n);
+    T* from = A;
+    T* to = buffer.data();
+
+    for (int shift = 0; shift < 8 * (int)sizeof(T); shift += 8) {
+        std::array<long, 256> counts{};
+        for (int i = 0; i < n; i++) {
+            counts[(radixKey(from[i]) >> shift) & 0xff]++;
+        }
+        if (n == 0 || counts[(radixKey(from[0]) >> shift) & 0xff] == n) {
+            continue;
+        }
+
+        long offset = 0;
+        for (long& count : counts) {
+            long digits = count;
+            count = offset;
+            offset += digits;
+        }
+        for (int i = 0; i < n; i++) {
+            to[counts[(radixKey(from[i]) >> shift) & 0xff]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+
+    if (from != A) {
+        std::copy(from, from + n, A);
+    }
+    return A;
+}
+
+
+/**
+ * @brief Sorts an array with a least-significant-digit radix sort over bytes, in parallel.
+ * "#pragma omp parallel" opens a single team of threads for the whole sort and each thread owns one contiguous slice.
+ * For every byte, each thread counts the digits of its slice; one thread turns the counts into the output offset
+ * of every (digit, thread) pair, in digit-major order so the scatter stays stable; then each thread scatters its slice.
+ * The buffer is first touched slice by slice, like the array.
+ * "#pragma omp barrier" separates the counting, the offsets and the scatter.
+ * 
+ * @tparam T the key type
+ * @param A the array to be sorted
+ * @param n the size of the array
+ * @return the sorted array
+*/
+template<typename T>
+T* sortRadixLSDParallel(T A[], int n)
+{
+    T* data = firstTouchArray<T>(n);
+    std::vector<std::array<long, 256>> counts;
+    bool skip = false;
+
+    // firstTouchArray() ran on the selected backend's team; the passes below run on OpenMP
+    noteOpenMPBackend();
+
+    #pragma omp parallel default(none) shared(A, n, data, counts, skip)
+    {
+        long threadId = 0;
+        long threadCount = 1;
+#ifdef _OPENMP
+        threadId = omp_get_thread_num();
+        threadCount = omp_get_num_threads();
+#endif
+        #pragma omp single
+        counts.resize(threadCount);
+
+        long begin = (long)n * threadId / threadCount;
+        long end = (long)n * (threadId + 1) / threadCount;
+        T* from = A;
+        T* to = data;
+
+        for (int shift = 0; shift < 8 * (int)sizeof(T); shift += 8) {
+            std::array<long, 256>& local = counts[threadId];
+            local.fill(0);
+            for (long i = begin; i < end; i++) {
+                local[(radixKey(from[i]) >> shift) & 0xff]++;
+            }
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                long same = 0;
+                if (n > 0) {
+                    for (long t = 0; t < threadCount; t++) {
+                        same += counts[t][(radixKey(from[0]) >> shift) & 0xff];
+                    }
+                }
+                skip = same == n;
+
+                long offset = 0;
+                for (int digit = 0; digit < 256; digit++) {
+                    for (long t = 0; t < threadCount; t++) {
+                        long digits = counts[t][digit];
+                        counts[t][digit] = offset;
+                        offset += digits;
+                    }
+                }
+            }
+
+            // The implicit barrier of "single" makes the offsets and skip visible to every thread
+            if (skip) {
+                continue;
+            }
+            for (long i = begin; i < end; i++) {
+                to[local[(radixKey(from[i]) >> shift) & 0xff]++] = from[i];
+            }
+            std::swap(from, to);
+            #pragma omp barrier
+        }
+
+        if (from != A) {
+            std::copy(from + begin, from + end, A + begin);
+        }
+    }
+
+    delete[] data;
+    return A;
+}
+
+
+/**
+ * @brief Measures the sustainable memory bandwidth with the STREAM copy and triad kernels.
+ * The kernels run on the selected backend's team, see runTeam(), so the peak is measured with the threads the
+ * listings use. The arrays are four times the last-level cache, or at least 32 MiB each, and are first touched
+ * by the threads that later stream them. Each kernel runs five times; the best rate of either kernel is returned,
+ * counting 16 bytes per element for copy and 24 for triad as STREAM does.
+ * @see https://www.cs.virginia.edu/stream/ref.html
+ * 
+ * @return the bandwidth in bytes per second
+*/
+long double measureBandwidth()
+{
+    long n = streamArrayLength();
+    double* a = new double[n];
+    double* b = new double[n];
+    double* c = new double[n];
+    const double scalar = 3.0;
+
+    long double best = 0;
+    std::chrono::steady_clock::time_point start;
+    runTeam([&](auto& team) {
+        team.stage([&](long threadId, long threadCount) {
+            for (long i = n * threadId / threadCount; i < n * (threadId + 1) / threadCount; i++) {
+                a[i] = 1.0;
+                b[i] = 2.0;
+                c[i] = 0.0;
+            }
+        });
+
+        for (int trial = 0; trial < 5; trial++) {
+            team.single([&] { start = std::chrono::steady_clock::now(); });
+            team.stage([&](long threadId, long threadCount) {
+                for (long i = n * threadId / threadCount; i < n * (threadId + 1) / threadCount; i++) {
+                    c[i] = a[i];
+                }
+            });
+            team.single([&] {
+                auto end = std::chrono::steady_clock::now();
+                best = std::max(best, 2.0L * sizeof(double) * n / std::chrono::duration<long double>(end - start).count());
+                start = std::chrono::steady_clock::now();
+            });
+            team.stage([&](long threadId, long threadCount) {
+                for (long i = n * threadId / threadCount; i < n * (threadId + 1) / threadCount; i++) {
+                    a[i] = b[i] + scalar * c[i];
+                }
+            });
+            team.single([&] {
+                auto end = std::chrono::steady_clock::now();
+                best = std::max(best, 3.0L * sizeof(double) * n / std::chrono::duration<long double>(end - start).count());
+            });
         }
+    });
 
-    // Add an empty row
-    outputFile << std::endl;
-
-    // Close the output file
-    outputFile.close();
+    // Keep the results live so the kernels are not optimised away
+    volatile double sink = a[n / 2] + c[n / 3];
+    (void)sink;
 
-    return 0;
+    delete[] a;
+    delete[] b;
+    delete[] c;
+    return best;
 }
 
 
 /**
- * Executes a sorting function and measures the execution time.
+ * Returns the peak memory bandwidth the listings about to run are compared with: --bandwidth if given, otherwise
+ * measureBandwidth() with backendThreadCount() threads, measured the first time each thread count is used.
  * 
- * @param A the array to be sorted
- * @param n the size of the array
- * @param sortFunc the sorting function
- * @param sortFuncName the name of the sorting function
- * @return the execution time
- * @see https://stackoverflow.com/questions/22387586/measuring-execution-time-of-a-function-in-c
+ * @param options the bandwidth given on the command line
+ * @return the bandwidth in bytes per second
 */
-long double executeListing(int A[], int n, int* (*sortFunc)(int[], int), const std::string& sortFuncName)
+long double peakBandwidth(const BenchmarkOptions& options)
 {
-    // Copy the array
-    int* ACopied = new int[n];
-    std::copy(A, A + n, ACopied);
-
-    // Execute the sorting function and measure execution time
-    auto start = std::chrono::high_resolution_clock::now();
-    int* ASorted = sortFunc(ACopied, n);
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> duration = end - start;
-
-    long double executionTime = duration.count() / 1000.0;
-
-    // Print the sorted array and execution time
-    cout << sortFuncName << ": ";
-    // for (int i = 0; i < n; i++) {
-    //     cout << ASorted[i] << " ";
-    // }
-    cout << endl;
-    cout << "Duration: " << executionTime << " seconds" << endl;
-
-    // Deallocate dynamic arrays
-    delete[] ACopied;
-
-    return executionTime;
+    if (options.bandwidth > 0) {
+        return options.bandwidth * 1e9L;
+    }
+    int threads = backendThreadCount();
+    auto found = peakBandwidths.find(threads);
+    if (found == peakBandwidths.end()) {
+        found = peakBandwidths.insert({threads, measureBandwidth()}).first;
+        cout << "Peak memory bandwidth: " << found->second / 1e9L << " GB/s on " << threads
+             << (threads == 1 ? " thread" : " threads") << endl;
+    }
+    return found->second;
 }
 
 
 /**
- * Sorts an array of integers using Listing 1.
+ * @brief Returns the fewest passes over the whole array a sorting function must make.
+ * The engines that count their passes report them in passCount. The other listings make one pass per
+ * (p,k) stage: L(L+1)/2 for L = ceil(log2 n) rounds. Listing4Hybrid and Listing4HybridPool sort their per-thread chunks in one pass
+ * and then make one pass per stage of the rounds p >= chunk. LSD radix sorts make one pass per key byte.
  * 
- * @param A the array to be sorted
+ * @param name the name of the sorting function, after it has run
  * @param n the size of the array
- * @return the sorted array
- * @see R. Sedgewick, "Algorithms in C++, 1992," ed: Addison-Wesley.
+ * @param keySize the size of a key in bytes
+ * @param threads the number of threads of the team it ran on, see BackendRun
+ * @return the number of passes, or 0 for the comparison-sort baselines, which have no fixed pass structure
 */
-int* sortListing1(int A[], int n)
+long minimumPasses(const std::string& name, int n, size_t keySize, int threads)
 {
-    for (int p = 1; p < n; p += p) 
-        for (int k = p; k > 0; k /= 2) 
-            for (int j = k % p; j + k < n; j += 2 * k) 
-                for (int i = 0; i < n-j-k; i++)
-                    if ((j+i) / (p+p) == (j+i+k)/(p+p))
-                        if (A[j+i] > A[j+i+k])
-                            swap(A[j+i], A[j+i+k]);
+    if (name.compare(0, 5, "Radix") == 0) {
+        return keySize;
+    }
+    if (isBaseline(name)) {
+        return 0;
+    }
+    if (passCount > 0) {
+        return passCount;
+    }
 
-    return A;
+    long rounds = 0;
+    while ((1L << rounds) < n) {
+        rounds++;
+    }
+    if (name.compare(0, 14, "Listing4Hybrid") == 0) {
+        long chunkRounds = 0;
+        while ((1L << chunkRounds) * std::max(threads, 1) < n) {
+            chunkRounds++;
+        }
+        return 1 + (rounds * (rounds + 1) - chunkRounds * (chunkRounds + 1)) / 2;
+    }
+    return rounds * (rounds + 1) / 2;
 }
 
 
 /**
- * @brief Sorts an array of integers using Listing 1 in parallel.
- * "#pragma omp parallel for" parallelises for loops.
- * "shared()" means that the variables inside it are shared between the threads.
- * "default(none)" means that all variables must be explicitly declared as shared or private.
+ * Tells whether a sorting function is one of the library or radix baselines rather than a listing.
  * 
- * @param A the array to be sorted
- * @param n the size of the array
- * @return the sorted array
+ * @param name the name of the sorting function
+ * @return true for a baseline
 */
-int* sortListing1Parallel(int A[], int n)
+bool isBaseline(const std::string& name)
 {
+    return name.compare(0, 7, "Listing") != 0;
+}
 
-    for (int p = 1; p < n; p *= 2) 
-    {
-        #pragma omp parallel for shared(A, n, p) default(none)
-        for (int k = p; k > 0; k /= 2) 
+
+/**
+ * Compare-exchanges two contiguous key runs and moves their payloads in lockstep.
+ * The runs must not overlap.
+ * 
+ * @param lo the key run holding the keys that come first afterwards
+ * @param hi the key run holding the keys that come last afterwards
+ * @param loValues the payloads of lo
+ * @param hiValues the payloads of hi
+ * @param len the number of elements in each run
+ * @param comp the ordering of the keys
+*/
+template<typename K, typename V, typename Compare>
+void compareExchangeRunKeyValue(K lo[], K hi[], V loValues[], V hiValues[], long len, Compare comp)
+{
+    for(long i = len; i--;)
+        if(comp(hi[i], lo[i]))
         {
-            #pragma omp parallel for shared(A, n, p, k) default(none)
-            for (int j = k % p; j + k < n; j += 2 * k) 
-            {
-                #pragma omp parallel for shared(A, n, p, k, j) default(none)
-                for (int i = 0; i < n-j-k; i++)
-                {
-                    if ((j+i) / (p+p) == (j+i+k)/(p+p))
-                    {
-                        if (A[j+i] > A[j+i+k])
-                        {
-                            // Ensures atomic access to the shared variable
-                            #pragma omp critical
-                            swap(A[j+i], A[j+i+k]);
-                        }
-                    }
-                }
-            }
+            std::swap(lo[i], hi[i]);
+            std::swap(loValues[i], hiValues[i]);
         }
-    }
-
-    return A;
 }
 
 
 /**
- * Sorts an array of integers using Listing 2.
+ * @brief Compare-exchanges int key runs with 32-bit payloads using AVX2.
+ * The keys take min/max as in compareExchangeRunAVX2(); the key comparison also gives a lane mask
+ * that blends the payloads, so a payload moves exactly when its key does.
+ * Must only be called when cpuHasAVX2() returns true.
  * 
- * @param A the array to be sorted
- * @param n the size of the array
- * @return the sorted array
+ * @param lo the key run holding the smaller keys afterwards
+ * @param hi the key run holding the larger keys afterwards
+ * @param loValues the payloads of lo
+ * @param hiValues the payloads of hi
+ * @param len the number of elements in each run
 */
-int* sortListing2(int A[], int n)
+#ifdef ODD_EVEN_SORT_HAVE_AVX2
+__attribute__((target("avx2")))
+void compareExchangeRunKeyValueAVX2(int lo[], int hi[], uint32_t loValues[], uint32_t hiValues[], int len)
 {
-    for(int p = 1; p < n; p *= 2) 
-        for(int k = p; k > 0; k /= 2) 
-            for(int j = k % p; j + k < 2*p; j += 2*k) 
-                for(int i = 0; i < k; i++) 
-                    for(int m = i + j; m < n - k; m += 2*p) 
-                        if(A[m] > A[m+k]) 
-                            swap(A[m], A[m+k]);
+    int i = 0;
+    for(; i + 8 <= len; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi + i));
+        __m256i swapped = _mm256_cmpgt_epi32(a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lo + i), _mm256_min_epi32(a, b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hi + i), _mm256_max_epi32(a, b));
 
-    return A;
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(loValues + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hiValues + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(loValues + i), _mm256_blendv_epi8(va, vb, swapped));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hiValues + i), _mm256_blendv_epi8(vb, va, swapped));
+    }
+    compareExchangeRunKeyValue(lo + i, hi + i, loValues + i, hiValues + i, len - i, std::less<int>());
 }
 
 
 /**
- * @brief Sorts an array of integers using Listing 2 in parallel.
- * "#pragma omp parallel for" parallelises for loops.
- * "shared()" means that the variables inside it are shared between the threads.
- * "default(none)" means that all variables must be explicitly declared as shared or private.
+ * @brief Compare-exchanges int key runs with 64-bit payloads using AVX2.
+ * Each 8-lane key mask is widened into two 4-lane masks, one per register of payloads.
+ * Must only be called when cpuHasAVX2() returns true.
  * 
- * @param A the array to be sorted
- * @param n the size of the array
- * @return the sorted array
+ * @param lo the key run holding the smaller keys afterwards
+ * @param hi the key run holding the larger keys afterwards
+ * @param loValues the payloads of lo
+ * @param hiValues the payloads of hi
+ * @param len the number of elements in each run
 */
-int* sortListing2Parallel(int A[], int n)
+__attribute__((target("avx2")))
+void compareExchangeRunKeyValueAVX2(int lo[], int hi[], uint64_t loValues[], uint64_t hiValues[], int len)
 {
-    // no parallelisation part
-    for(int p = 1; p < n; p *= 2) 
+    int i = 0;
+    for(; i + 8 <= len; i += 8)
     {
-        #pragma omp parallel for shared(A, n, p) default(none)
-        for(int k = p; k > 0; k /= 2) 
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi + i));
+        __m256i swapped = _mm256_cmpgt_epi32(a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lo + i), _mm256_min_epi32(a, b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hi + i), _mm256_max_epi32(a, b));
+
+        for(int half = 0; half < 2; half++)
         {
-            #pragma omp parallel for shared(A, n, p, k) default(none)
-            for(int j = k % p; j + k < 2*p; j += 2*k) 
-            {
-                #pragma omp parallel for shared(A, n, p, k, j) default(none)
-                for(int i = 0; i < k; i++) 
-                {
-                    #pragma omp parallel for shared(A, n, p, k, j, i) default(none)
-                    for(int m = i + j; m < n - k; m += 2*p) 
-                    {
-                        if(A[m] > A[m+k]) 
-                        {
-                            // "#pragma omp critical" ensures that only one thread can access the shared variable at a time.
-                            #pragma omp critical
-                            swap(A[m], A[m+k]);
-                        }
-                    }
-                }
-            }
+            __m256i mask = _mm256_cvtepi32_epi64(half ? _mm256_extracti128_si256(swapped, 1) : _mm256_castsi256_si128(swapped));
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(loValues + i + 4*half));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hiValues + i + 4*half));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(loValues + i + 4*half), _mm256_blendv_epi8(va, vb, mask));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(hiValues + i + 4*half), _mm256_blendv_epi8(vb, va, mask));
         }
     }
-    return A;
+    compareExchangeRunKeyValue(lo + i, hi + i, loValues + i, hiValues + i, len - i, std::less<int>());
 }
-int* sortListing2ParallelAlt(int A[], int n)
+#else
+void compareExchangeRunKeyValueAVX2(int lo[], int hi[], uint32_t loValues[], uint32_t hiValues[], int len)
 {
-    for(int p = 1; p < n; p *= 2) 
-    {
-        #pragma omp parallel for shared(A, n, p) default(none)
-        for(int k = p; k > 0; k /= 2) 
-        {
-            #pragma omp parallel for shared(A, n, p, k) default(none)
-            for(int j = k % p; j + k < 2*p; j += 2*k) 
-            {
-                #pragma omp parallel for shared(A, n, p, k, j) default(none)
-                for(int i = 0; i < k; i++) 
-                {
-                    #pragma omp parallel for shared(A, n, p, k, j, i) reduction(min : m) default(none)
-                    for(int m = i + j; m < n - k; m += 2*p) 
-                    {
-                        if(A[m] > A[m+k]) 
-                        {
-                            swap(A[m], A[m+k]);
-                        }
-                    }
-                }
-            }
-        }
-    }
-    return A;
+    compareExchangeRunKeyValue(lo, hi, loValues, hiValues, len, std::less<int>());
+}
+void compareExchangeRunKeyValueAVX2(int lo[], int hi[], uint64_t loValues[], uint64_t hiValues[], int len)
+{
+    compareExchangeRunKeyValue(lo, hi, loValues, hiValues, len, std::less<int>());
 }
+#endif
 
 
 /**
- * Sorts an array of integers using Listing 3.
+ * @brief Compare-exchanges key runs and their payloads with the fastest kernel available.
+ * int keys in ascending or descending order with 32- or 64-bit payloads use AVX2
+ * for runs of at least one full vector; everything else uses the scalar kernel.
  * 
- * @param A the array to be sorted
- * @param n the size of the array
- * @return the sorted array
+ * @param lo the key run holding the keys that come first afterwards
+ * @param hi the key run holding the keys that come last afterwards
+ * @param loValues the payloads of lo
+ * @param hiValues the payloads of hi
+ * @param len the number of elements in each run
+ * @param comp the ordering of the keys
+ * @param useAVX2 whether the AVX2 kernel may be used
 */
-int* sortListing3(int A[], int n)
+template<typename K, typename V, typename Compare>
+void compareExchangeRunKeyValueVector(K lo[], K hi[], V loValues[], V hiValues[], long len, Compare comp, bool useAVX2)
 {
-    for (int p = 1; p < n; p *= 2) 
-        for (int k = p; k > 0; k /= 2) 
-            for (int j = k % p; j + k < n; j += 2*k) 
-                for (int i = std::min(k, n-j-k); i--;) 
-                    if ((j+i)/(2*p) == (j+i+k)/(2*p)) 
-                        if (A[j+i] > A[j+i+k]) 
-                            std::swap(A[j+i], A[j+i+k]);
-
-    return A;
+    constexpr bool vectorPayload = std::is_same<V, uint32_t>::value || std::is_same<V, uint64_t>::value;
+    if constexpr (vectorPayload && std::is_same<K, int>::value && std::is_same<Compare, std::less<int>>::value)
+    {
+        if(useAVX2 && len >= 8)
+            return compareExchangeRunKeyValueAVX2(lo, hi, loValues, hiValues, len);
+    }
+    if constexpr (vectorPayload && std::is_same<K, int>::value && std::is_same<Compare, std::greater<int>>::value)
+    {
+        if(useAVX2 && len >= 8)
+            return compareExchangeRunKeyValueAVX2(hi, lo, hiValues, loValues, len);
+    }
+    compareExchangeRunKeyValue(lo, hi, loValues, hiValues, len, comp);
 }
 
 
 /**
- * @brief Sorts an array of integers using Listing 3 in parallel.
- * "#pragma omp parallel for" parallelises for loops.
- * "shared()" means that the variables inside it are shared between the threads.
- * "default(none)" means that all variables must be explicitly declared as shared or private.
+ * @brief Sorts keys using Listing 3 and applies every exchange to a payload array in lockstep.
+ * This is the structure-of-arrays layout; the array-of-structures layout is sortListing3 over KeyValue.
  * 
- * @param A the array to be sorted
- * @param n the size of the array
- * @return the sorted array
+ * @tparam K the key type
+ * @tparam V the payload type
+ * @tparam Compare the ordering of the keys, std::less<K> for ascending
+ * @param keys the keys to be sorted
+ * @param values the payloads, permuted exactly as the keys
+ * @param n the size of the arrays
+ * @return the sorted keys
 */
-int* sortListing3Parallel(int A[], int n)
+template<typename K, typename V, typename Compare>
+K* sortListing3KeyValue(K keys[], V values[], int n)
 {
+    Compare comp{};
+
     for (int p = 1; p < n; p *= 2) 
-    {
-        #pragma omp parallel for shared(A, n, p) default(none)
         for (int k = p; k > 0; k /= 2) 
-        {
-            #pragma omp parallel for shared(A, n, p, k) default(none)
             for (int j = k % p; j + k < n; j += 2*k) 
-            {
-                #pragma omp parallel for shared(A, n, p, k, j) default(none)
                 for (int i = std::min(k, n-j-k); i--;) 
-                {
                     if ((j+i)/(2*p) == (j+i+k)/(2*p)) 
-                    {
-                        if (A[j+i] > A[j+i+k]) 
+                        if (comp(keys[j+i+k], keys[j+i]))
                         {
-                            // Ensures atomic access to the shared variable
-                            #pragma omp critical
-                            std::swap(A[j+i], A[j+i+k]);
+                            std::swap(keys[j+i], keys[j+i+k]);
+                            std::swap(values[j+i], values[j+i+k]);
                         }
-                    }
-                }
-            }
-        }
-    }
 
-    return A;
+    return keys;
 }
 
 
 /**
- * Sorts an array of integers using Listing 4.
+ * @brief Sorts keys using Listing 4 and applies every exchange to a payload array in lockstep.
+ * This is the structure-of-arrays layout; the array-of-structures layout is sortListing4 over KeyValue.
+ * The inner loop is vectorised like sortListing4AVX2, with the key comparison masking the payload moves.
  * 
- * @param A the array to be sorted
- * @param n the size of the array
- * @return the sorted array
+ * @tparam K the key type
+ * @tparam V the payload type
+ * @tparam Compare the ordering of the keys, std::less<K> for ascending
+ * @param keys the keys to be sorted
+ * @param values the payloads, permuted exactly as the keys
+ * @param n the size of the arrays
+ * @return the sorted keys
 */
-int* sortListing4(int A[], int n)
+template<typename K, typename V, typename Compare>
+K* sortListing4KeyValue(K keys[], V values[], int n)
 {
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+
     for(int p = 1; p < n; p *= 2)
         for(int k = p; k > 0; k /= 2)
             for(int j = k & (p - 1); j + k < n; j += 2*k)
                 if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
-                    for(int i = std::min(k, n-j-k); i--;)
-                        if(A[j+i] > A[j+i+k])
-                            std::swap(A[j+i], A[j+i+k]);
+                    compareExchangeRunKeyValueVector(keys + j, keys + j + k, values + j, values + j + k,
+                                                     std::min(k, n-j-k), comp, useAVX2);
 
-    return A;
+    return keys;
 }
 
 
 /**
- * @brief Sorts an array of integers using Listing 4 in parallel.
- * "#pragma omp parallel for" parallelises for loops.
- * "shared()" means that the variables inside it are shared between the threads.
- * "default(none)" means that all variables must be explicitly declared as shared or private.
+ * Lists the comparators of Listing 4 for an array of length n, in the order Listing 4 applies them.
  * 
- * @param A the array to be sorted
- * @param n the size of the array
- * @return the sorted array
+ * @param n the length of the array
+ * @return the (lower, upper) index pairs to compare-exchange
 */
-int* sortListing4Parallel(int A[], int n)
+std::vector<std::pair<int, int>> comparatorSchedule(int n)
 {
-    #pragma omp parallel for default(none) shared(A,n)
+    std::vector<std::pair<int, int>> schedule;
     for(int p = 1; p < n; p *= 2)
-    {
-        #pragma omp for
         for(int k = p; k > 0; k /= 2)
-        {
-            #pragma omp for
             for(int j = k & (p - 1); j + k < n; j += 2*k)
-            {
                 if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
-                {
-                    #pragma omp for
                     for(int i = std::min(k, n-j-k); i--;)
-                    {
-                        if(A[j+i] > A[j+i+k])
-                        {
-                            std::swap(A[j+i], A[j+i+k]);
-                        }
-                    }
-                }
-            }
+                        schedule.push_back({j+i, j+i+k});
+    return schedule;
+}
+
+
+/**
+ * @brief Stores small arrays in the transposed layout used by sortBatchTransposed.
+ * The arrays are grouped into batches of batchLanes; element e of lane a of batch b is at
+ * data[(b * length + e) * batchLanes + a]. Unused lanes of the last batch repeat the last array.
+ * 
+ * @param arrays the arrays one after another, arrayCount * length elements
+ * @param data the transposed storage, ceil(arrayCount / batchLanes) * batchLanes * length elements
+ * @param length the length of every array
+ * @param arrayCount the number of arrays
+*/
+template<typename T>
+void interleaveArrays(const T arrays[], T data[], int length, long arrayCount)
+{
+    long batches = (arrayCount + batchLanes - 1) / batchLanes;
+    for(long b = 0; b < batches; b++)
+        for(int a = 0; a < batchLanes; a++)
+        {
+            long source = std::min(b * batchLanes + a, arrayCount - 1);
+            for(int e = 0; e < length; e++)
+                data[(b * length + e) * batchLanes + a] = arrays[source * length + e];
+        }
+}
+
+
+/**
+ * Copies arrays back out of the transposed layout, dropping the unused lanes of the last batch.
+ * 
+ * @param data the transposed storage
+ * @param arrays the arrays one after another, arrayCount * length elements
+ * @param length the length of every array
+ * @param arrayCount the number of arrays
+*/
+template<typename T>
+void deinterleaveArrays(const T data[], T arrays[], int length, long arrayCount)
+{
+    for(long a = 0; a < arrayCount; a++)
+        for(int e = 0; e < length; e++)
+            arrays[a * length + e] = data[((a / batchLanes) * length + e) * batchLanes + a % batchLanes];
+}
+
+
+/**
+ * @brief Applies a comparator schedule to batches of int arrays in the transposed layout using AVX2.
+ * Every comparator becomes one vertical min/max over the two rows of batchLanes elements it connects.
+ * Must only be called when cpuHasAVX2() returns true.
+ * 
+ * @param data the transposed storage
+ * @param length the length of every array
+ * @param batches the number of batches
+ * @param schedule the comparators from comparatorSchedule(length)
+*/
+#ifdef ODD_EVEN_SORT_HAVE_AVX2
+__attribute__((target("avx2")))
+void sortBatchTransposedAVX2(int data[], int length, long batches, const std::vector<std::pair<int, int>>& schedule)
+{
+    static_assert(batchLanes == 8, "one AVX2 register holds one row of a batch");
+    for(long b = 0; b < batches; b++)
+    {
+        int* batch = data + b * length * batchLanes;
+        for(const auto& c : schedule)
+        {
+            __m256i* lo = reinterpret_cast<__m256i*>(batch + c.first * batchLanes);
+            __m256i* hi = reinterpret_cast<__m256i*>(batch + c.second * batchLanes);
+            __m256i a = _mm256_loadu_si256(lo);
+            __m256i d = _mm256_loadu_si256(hi);
+            _mm256_storeu_si256(lo, _mm256_min_epi32(a, d));
+            _mm256_storeu_si256(hi, _mm256_max_epi32(a, d));
+        }
+    }
+}
+#else
+void sortBatchTransposedAVX2(int data[], int length, long batches, const std::vector<std::pair<int, int>>& schedule)
+{
+    for(long b = 0; b < batches; b++)
+        for(const auto& c : schedule)
+            compareExchangeRun(data + (b * length + c.first) * batchLanes,
+                               data + (b * length + c.second) * batchLanes, batchLanes, std::less<int>());
+}
+#endif
+
+
+/**
+ * @brief Sorts many independent small arrays stored in the transposed layout.
+ * The comparator schedule of Listing 4 depends only on the array length, so it is built once and
+ * each comparator is applied to all batchLanes arrays of a batch at once, as a vertical min/max
+ * on two rows. Ascending int keys use AVX2; other keys use the scalar kernel on each row pair.
+ * 
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param data the arrays in the layout produced by interleaveArrays
+ * @param length the length of every array
+ * @param batches the number of batches of batchLanes arrays
+ * @return the sorted data
+*/
+template<typename T, typename Compare>
+T* sortBatchTransposed(T data[], int length, long batches)
+{
+    Compare comp{};
+    static const bool useAVX2 = cpuHasAVX2();
+    std::vector<std::pair<int, int>> schedule = comparatorSchedule(length);
+
+    if constexpr (std::is_same<T, int>::value && std::is_same<Compare, std::less<int>>::value)
+    {
+        if(useAVX2)
+        {
+            sortBatchTransposedAVX2(data, length, batches, schedule);
+            return data;
         }
     }
 
+    for(long b = 0; b < batches; b++)
+    {
+        T* batch = data + b * length * batchLanes;
+        for(const auto& c : schedule)
+            compareExchangeRun(batch + c.first * batchLanes, batch + c.second * batchLanes, batchLanes, comp);
+    }
+
+    return data;
+}
+
+
+/**
+ * Counts the comparators Listing 4 applies to an array of length N, at compile time.
+ * 
+ * @tparam N the length of the array
+ * @return the number of comparators
+*/
+template<int N>
+constexpr int comparatorCount()
+{
+    int count = 0;
+    for(int p = 1; p < N; p *= 2)
+        for(int k = p; k > 0; k /= 2)
+            for(int j = k & (p - 1); j + k < N; j += 2*k)
+                if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
+                    count += std::min(k, N-j-k);
+    return count;
+}
+
+static_assert(comparatorCount<16>() == 63 && comparatorCount<32>() == 191 && comparatorCount<64>() == 543,
+              "Batcher's odd-even merge sort network sizes");
+
+
+/**
+ * Generates the comparators of Listing 4 for an array of length N at compile time,
+ * in the same order as the loop nest applies them.
+ * 
+ * @tparam N the length of the array
+ * @return the comparator network
+*/
+template<int N>
+constexpr std::array<Comparator, comparatorCount<N>()> comparatorNetwork()
+{
+    std::array<Comparator, comparatorCount<N>()> network{};
+    int c = 0;
+    for(int p = 1; p < N; p *= 2)
+        for(int k = p; k > 0; k /= 2)
+            for(int j = k & (p - 1); j + k < N; j += 2*k)
+                if((j | (2*p - 1)) == ((j+k) | (2*p - 1)))
+                    for(int i = std::min(k, N-j-k); i--;)
+                        network[c++] = {j+i, j+i+k};
+    return network;
+}
+
+
+// The comparator network for length N, evaluated once at compile time
+template<int N>
+constexpr std::array<Comparator, comparatorCount<N>()> oddEvenMergeNetwork = comparatorNetwork<N>();
+
+
+/**
+ * Compare-exchanges two elements without a branch, so the compiler can emit min/max or conditional moves.
+ * 
+ * @param a the element that comes first afterwards
+ * @param b the element that comes last afterwards
+ * @param comp the ordering of the keys
+*/
+template<typename T, typename Compare>
+inline void compareExchange(T& a, T& b, Compare comp)
+{
+    bool exchange = comp(b, a);
+    T first = exchange ? b : a;
+    T last = exchange ? a : b;
+    a = first;
+    b = last;
+}
+
+
+/**
+ * Applies every comparator of the length-N network as straight-line code, one compareExchange per index in C.
+ * 
+ * @param A the array to be sorted
+ * @param comp the ordering of the keys
+*/
+template<int N, typename T, typename Compare, std::size_t... C>
+inline void applyFixedNetwork(T A[], Compare comp, std::index_sequence<C...>)
+{
+    (compareExchange(A[oddEvenMergeNetwork<N>[C].lo], A[oddEvenMergeNetwork<N>[C].hi], comp), ...);
+}
+
+
+/**
+ * @brief Sorts an array whose length N is known at compile time.
+ * The Listing 4 loop nest is evaluated by the compiler into a fixed comparator list, which is
+ * then fully unrolled into branchless compare-exchanges on constant indices.
+ * 
+ * @tparam N the length of the array
+ * @tparam T the key type
+ * @tparam Compare the ordering of the keys, std::less<T> for ascending
+ * @param A the array to be sorted
+ * @return the sorted array
+*/
+template<int N, typename T, typename Compare>
+T* sortFixed(T A[])
+{
+    applyFixedNetwork<N>(A, Compare(), std::make_index_sequence<comparatorCount<N>()>());
     return A;
-}
\ No newline at end of file
+}